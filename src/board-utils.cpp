@@ -86,7 +86,7 @@ namespace Chess {
 	for(int i = 0; i < NPieces; i++) {
 	  basicState.pieceSquares[i] = InvalidSquare;
 	}
-	basicState.epSquare = InvalidSquare;
+	storeEpSquare(basicState, InvalidSquare);
       }
       return board;
     }
@@ -96,6 +96,8 @@ namespace Chess {
 
       addStartingPieces(board, White, A1, A2);
       addStartingPieces(board, Black, A8, A7);
+
+      board.zobristKey = genZobristKey(board);
       
       return board;
     }
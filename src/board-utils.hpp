@@ -283,12 +283,10 @@ namespace Chess {
       
       typedef typename MoveGen::PieceBbsImplType<BoardT>::PieceBbsT PieceBbsT;
       typedef typename MoveGen::ColorPieceBbsImplType<BoardT>::ColorPieceBbsT ColorPieceBbsT;
-      typedef typename MoveGen::PieceAttackBbsImplType<BoardT>::PieceAttackBbsT PieceAttackBbsT;
       
       const ColorT OtherColor = OtherColorT<Color>::value;
       
       const ColorStateT& myState = board.state[(size_t)Color];
-      const ColorStateT& yourState = board.state[(size_t)OtherColor];
 
       const PieceBbsT& pieceBbs = MoveGen::genPieceBbs<BoardT, Color>(board);
 
@@ -303,9 +301,9 @@ namespace Chess {
       const BitBoardT myKingBb = bbForSquare(myKingSq);
       
       // Exclude my king from the all-pieces mask so we get x-raw attacks through the king (which are still check)
-      const PieceAttackBbsT yourAttackBbs = MoveGen::genPieceAttackBbs<BoardT, OtherColor>(yourState, allPiecesBb & ~myKingBb);
+      const BitBoardT yourAttacksBb = MoveGen::genAllAttacksBb<BoardT, OtherColor>(yourPieceBbs, allPiecesBb & ~myKingBb);
 
-      const BitBoardT myLegalKingMovesBb = MoveGen::KingAttacks[myKingSq] & ~allMyPiecesBb & ~yourAttackBbs.allAttacksBb;
+      const BitBoardT myLegalKingMovesBb = MoveGen::KingAttacks[myKingSq] & ~allMyPiecesBb & ~yourAttacksBb;
 
       if(debug) {
       	printf("My king attacks:\n");
@@ -313,7 +311,7 @@ namespace Chess {
       	printf("\nAll my pieces:\n");
       	BoardUtils::printBb(allMyPiecesBb);
       	printf("\nAll your attacks:\n");
-      	BoardUtils::printBb(yourAttackBbs.allAttacksBb);
+      	BoardUtils::printBb(yourAttacksBb);
       	printf("\nLegal king moves\n:");
       	BoardUtils::printBb(myLegalKingMovesBb);
       }
@@ -322,27 +320,91 @@ namespace Chess {
     }
     
 
+    // Early-exit check evasion test - only valid if my king is in check (allMyKingAttackersBb != BbNone).
+    // We stop at the first legal evasion found, trying in turn king escapes, then capture or blocking of the checker.
+    // Only my unpinned pieces can evade - see the check evasion notes at MoveGen::genLegalEvasionMoves() - which we
+    //   look at set-wise, sharing the pawn evasions (including en-passant) with move generation.
     template <typename BoardT, ColorT Color>
-    inline bool hasLegalMoves(const BoardT& board) {
-      const bool hasKingMoves = hasLegalKingMoves<BoardT, Color>(board);
-      if(hasKingMoves) {
-      	return true;
+    inline bool hasLegalEvasions(const BoardT& board, const typename MoveGen::PieceBbsImplType<BoardT>::PieceBbsT& pieceBbs, const BitBoardT allMyKingAttackersBb) {
+      typedef typename BoardT::ColorStateT ColorStateT;
+      
+      typedef typename MoveGen::ColorPieceBbsImplType<BoardT>::ColorPieceBbsT ColorPieceBbsT;
+      
+      const ColorT OtherColor = OtherColorT<Color>::value;
+      
+      const ColorStateT& myState = board.state[(size_t)Color];
+
+      const ColorPieceBbsT& myPieceBbs = pieceBbs.colorPieceBbs[(size_t)Color];
+      const ColorPieceBbsT& yourPieceBbs = pieceBbs.colorPieceBbs[(size_t)OtherColor];
+      
+      const BitBoardT allMyPiecesBb = myPieceBbs.bbs[AllPieceTypes];
+      const BitBoardT allYourPiecesBb = yourPieceBbs.bbs[AllPieceTypes];
+      const BitBoardT allPiecesBb = allMyPiecesBb | allYourPiecesBb;
+      
+      const SquareT myKingSq = myState.basic.pieceSquares[TheKing];
+      const BitBoardT myKingBb = bbForSquare(myKingSq);
+
+      // King escapes - exclude my king from the all-pieces mask so we get x-ray attacks through the king (which are still check)
+      const BitBoardT yourAttacksBb = MoveGen::genAllAttacksBb<BoardT, OtherColor>(yourPieceBbs, allPiecesBb & ~myKingBb);
+      if((MoveGen::KingAttacks[myKingSq] & ~allMyPiecesBb & ~yourAttacksBb) != BbNone) {
+	return true;
+      }
+
+      // Double check can only be evaded by moving the king
+      if(Bits::count(allMyKingAttackersBb) > 1) {
+	return false;
+      }
+
+      // Capture the checker, or block if it's a distant slider check
+      const BitBoardT legalMoveMaskBb = MoveGen::genLegalMoveMaskBbForSingleCheck<BoardT, Color>(allMyKingAttackersBb, myKingSq);
+
+      const MoveGen::KingRayBbsT myKingRayBbs = MoveGen::genKingRayBbs(myKingSq, allPiecesBb, allMyPiecesBb, yourPieceBbs.sliderBbs[Diagonal], yourPieceBbs.sliderBbs[Orthogonal]);
+      const BitBoardT myUnpinnedBb = MoveGen::genUnpinnedPiecesBb(allMyPiecesBb, myKingRayBbs);
+
+      // Pawns - captures can only be of the checker, pushes can only be blocks
+      const MoveGen::PawnPushesAndCapturesT pawnEvasions = MoveGen::genLegalPawnEvasions<BoardT, Color>(board, yourPieceBbs, myPieceBbs.bbs[Pawn] & myUnpinnedBb, allMyKingAttackersBb, legalMoveMaskBb, allPiecesBb);
+      if((pawnEvasions.pushesOneBb | pawnEvasions.pushesTwoBb | pawnEvasions.capturesLeftBb | pawnEvasions.capturesRightBb | pawnEvasions.epCaptures.epLeftCaptureBb | pawnEvasions.epCaptures.epRightCaptureBb) != BbNone) {
+	return true;
+      }
+
+      // Knights and sliders, including promo pieces
+      const BitBoardT knightsAttacksBb = MoveGen::genKnightsAttacksBb(myPieceBbs.bbs[Knight] & myUnpinnedBb);
+      if((knightsAttacksBb & legalMoveMaskBb) != BbNone) {
+	return true;
       }
+      const BitBoardT slidersAttacksBb = SliderFill::allSliderAttacksBb(myPieceBbs.sliderBbs[Diagonal] & myUnpinnedBb, myPieceBbs.sliderBbs[Orthogonal] & myUnpinnedBb, allPiecesBb);
+      
+      return (slidersAttacksBb & legalMoveMaskBb) != BbNone;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline bool hasLegalMoves(const BoardT& board) {
+      typedef typename BoardT::ColorStateT ColorStateT;
+      
+      typedef typename MoveGen::PieceBbsImplType<BoardT>::PieceBbsT PieceBbsT;
+      typedef typename MoveGen::ColorPieceBbsImplType<BoardT>::ColorPieceBbsT ColorPieceBbsT;
+      
+      const ColorT OtherColor = OtherColorT<Color>::value;
       
-      const bool hasMoves = hasLegalMovesSlow<BoardT, Color>(board);
-
-      if(hasKingMoves && !hasMoves) {
-      	static bool done = false;
-      	if(!done) {
-      	  printf("Booooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooo\n");
-      	  BoardUtils::printBoard(board);
-      	  printf("\n");
-      	  hasLegalKingMoves<BoardT, Color>(board, true);
-      	  done = true;
-      	}
+      const ColorStateT& myState = board.state[(size_t)Color];
+
+      const PieceBbsT pieceBbs = MoveGen::genPieceBbs<BoardT, Color>(board);
+
+      const ColorPieceBbsT& myPieceBbs = pieceBbs.colorPieceBbs[(size_t)Color];
+      const ColorPieceBbsT& yourPieceBbs = pieceBbs.colorPieceBbs[(size_t)OtherColor];
+      
+      const BitBoardT allPiecesBb = myPieceBbs.bbs[AllPieceTypes] | yourPieceBbs.bbs[AllPieceTypes];
+      
+      const SquareT myKingSq = myState.basic.pieceSquares[TheKing];
+      const MoveGen::SquareAttackerBbsT myKingAttackerBbs = MoveGen::genSquareAttackerBbs<BoardT, OtherColor>(myKingSq, yourPieceBbs, allPiecesBb);
+      const BitBoardT allMyKingAttackersBb = myKingAttackerBbs.pieceAttackerBbs[AllPieceTypes];
+
+      // We only ever call this for checking moves, but just in case
+      if(allMyKingAttackersBb == BbNone) {
+	return hasLegalMovesSlow<BoardT, Color>(board);
       }
 
-      return hasMoves;
+      return hasLegalEvasions<BoardT, Color>(board, pieceBbs, allMyKingAttackersBb);
     }
 
     // TODO - this can be optimised to use common heritage with hasLegalKingMoves.
@@ -2,18 +2,31 @@
 #define BOARD_HPP
 
 #include <array>
+#include <cassert>
 #include <utility>
 #include <vector>
 
 #include "bits.hpp"
 #include "types.hpp"
+#include "zobrist.hpp"
 
 namespace Chess {
 
   namespace Board {
 
+    using namespace Zobrist;
+
+    // Board layout
+    //
+    // The color states are byte-packed so that a FullColorStateImplT is 28 bytes rather than 40 - the promo state sits
+    //   where the padding after the pieces used to be, and castling rights and the ep square share a byte.
+    // That makes a FullBoardT exactly one 64-byte cache line, and a BasicBoardT fits in one too. Boards are aligned to
+    //   64 bytes so that they never straddle two lines, and the copy in every copy-make is one zmm move with AVX-512,
+    //   or two ymm moves with AVX2.
+    // The pawns bitboard of the second color is not 8-byte aligned - x86 doesn't care as long as it doesn't cross a line.
+
     // TODO actually would be neater to templatise on size of promos array, doh! Then no nested structures    
-    struct NonPromosColorStateImplT {
+    struct __attribute__((packed)) NonPromosColorStateImplT {
       // Pawns bitboard
       BitBoardT pawnsBb;
 
@@ -21,13 +34,25 @@ namespace Chess {
       // MUST be InvalidSquare if a piece is not present - see emptyBoard()
       SquareT pieceSquares[NPieces];
 
-      // InvalidSquare, or else en-passant square of the last move - i.e. the square behind a pawn two-square push.
-      SquareT epSquare;
-
       // Castling rights
-      CastlingRightsT castlingRights;
+      CastlingRightsT castlingRights : 2;
+
+      // InvalidSquare, or else en-passant square of the last move - i.e. the square behind a pawn two-square push.
+      // Ep squares are only ever on the 3rd and 6th ranks, so epSquare - A3 fits in the rest of the castling rights byte -
+      //   including InvalidSquare - A3. Use getEpSquare() and storeEpSquare().
+      u8 epSquareLessA3 : 6;
     };
 
+    inline SquareT getEpSquare(const NonPromosColorStateImplT& basicState) {
+      return (SquareT)(basicState.epSquareLessA3 + A3);
+    }
+
+    inline void storeEpSquare(NonPromosColorStateImplT& basicState, const SquareT epSquare) {
+      // Anything off the 3rd and 6th ranks would wrap - parseFen() rejects those
+      assert(epSquare == InvalidSquare || ((Rank3 | Rank6) & bbForSquare(epSquare)) != BbNone);
+      basicState.epSquareLessA3 = (u8)(epSquare - A3);
+    }
+
     struct BasicColorStateImplT {
       NonPromosColorStateImplT basic;
     };
@@ -40,7 +65,6 @@ namespace Chess {
       PromoPieceAndSquareT promos[NPawns];
     };
 
-    // TODO - this doesn't pack nicely - should be 32 bytes but is 40 bytes
     struct FullColorStateImplT {
       NonPromosColorStateImplT basic;
       PromosColorStateImplT promos;
@@ -49,15 +73,36 @@ namespace Chess {
     // Don't use this directly with zero-initialisation or you'll be disappointed because some fields need InvalidSquare (!= 0) init.
     // Use emptyBoard() or startingPosition() or parseFen().
     template <typename ColorStateImplT>
-    struct BasicBoardImplT {
+    struct alignas(64) BasicBoardImplT {
       typedef ColorStateImplT ColorStateT;
       
       ColorStateImplT state[NColors];
+
+      // Incrementally updated Zobrist key - see zobrist.hpp and genZobristKey().
+      // Does not include the color to move, and only includes the ep square if it is capturable.
+      ZobristKeyT zobristKey;
     };
 
     typedef BasicBoardImplT<BasicColorStateImplT> BasicBoardT;
     typedef BasicBoardImplT<FullColorStateImplT> FullBoardT;
 
+    static_assert(sizeof(FullColorStateImplT) == 28, "unexpected padding in FullColorStateImplT");
+    static_assert(sizeof(BasicBoardT) == 64 && sizeof(FullBoardT) == 64, "boards should be exactly one cache line");
+
+    // Piece bitboards for one color - bbs[AllPieceTypes] is the color's occupancy
+    struct ColorBbsImplT {
+      BitBoardT bbs[NPieceTypes];
+    };
+
+    // A BasicBoardT that also carries its piece bitboards, kept up to date by the mutators below,
+    //   so that move generation can just read them rather than rebuilding them from the piece squares at every node.
+    // This trades a bigger board copy per move for less work per node - perft --bbs-board compares the two.
+    // Promos upgrade to a plain FullBoardT, and anything that takes a BasicBoardT takes this too.
+    // Use copyBoard() to make one.
+    struct BasicBbsBoardT : BasicBoardT {
+      ColorBbsImplT colorBbs[NColors];
+    };
+
     template <typename BoardT>
     struct BoardType {};
 
@@ -66,16 +111,55 @@ namespace Chess {
       typedef BasicBoardT WithoutPromosT;
     };
 
+    template <> struct BoardType<BasicBbsBoardT> {
+      typedef FullBoardT WithPromosT;
+      typedef BasicBbsBoardT WithoutPromosT;
+    };
+
     template <> struct BoardType<FullBoardT> {
       typedef FullBoardT WithPromosT;
       typedef BasicBoardT WithoutPromosT;
     };
 
+    // Piece bitboard maintenance - only BasicBbsBoardT has any
+    template <typename BoardT>
+    inline void updatePieceBbs(BoardT& board, const ColorT color, const PieceTypeT pieceType, const BitBoardT squareBb) {}
+
+    inline void updatePieceBbs(BasicBbsBoardT& board, const ColorT color, const PieceTypeT pieceType, const BitBoardT squareBb) {
+      ColorBbsImplT& colorBbs = board.colorBbs[(size_t)color];
+      colorBbs.bbs[pieceType] ^= squareBb;
+      colorBbs.bbs[AllPieceTypes] ^= squareBb;
+    }
+
+    template <typename BoardT>
+    inline void initPieceBbs(BoardT& board) {}
+
+    inline void initPieceBbs(BasicBbsBoardT& board) {
+      for(size_t color = 0; color < NColors; color++) {
+	const NonPromosColorStateImplT& basicState = board.state[color].basic;
+	ColorBbsImplT& colorBbs = board.colorBbs[color];
+
+	colorBbs = {};
+	colorBbs.bbs[Pawn] = basicState.pawnsBb;
+	// bbForSquare(InvalidSquare) is BbNone
+	for(PieceT piece = Knight1; piece < NPieces; piece = (PieceT)(piece+1)) {
+	  colorBbs.bbs[PieceTypeForPiece[piece]] |= bbForSquare(basicState.pieceSquares[piece]);
+	}
+	for(int pieceType = Pawn; pieceType < NPieceTypes; pieceType++) {
+	  colorBbs.bbs[AllPieceTypes] |= colorBbs.bbs[pieceType];
+	}
+      }
+    }
+
     template <typename BoardOutputT, typename BoardInputT>
     inline BoardOutputT copyBoard(const BoardInputT& board) {
       BoardOutputT newBoard = {};
       newBoard.state[(size_t)White].basic = board.state[(size_t)White].basic;
       newBoard.state[(size_t)Black].basic = board.state[(size_t)Black].basic;
+      // Promo pieces hash by piece type and square so the key is the same for Basic and Full boards
+      newBoard.zobristKey = board.zobristKey;
+
+      initPieceBbs(newBoard);
       
       return newBoard;
     }
@@ -134,13 +218,112 @@ namespace Chess {
       return pieceMap;
     }
 
+    template <typename BoardT>
+    inline void removeCastlingRights(BoardT& board, const ColorT color, const PieceT piece) {
+      NonPromosColorStateImplT& basicState = board.state[(size_t)color].basic;
+
+      const CastlingRightsT lostCastlingRights = (CastlingRightsT) (basicState.castlingRights & CastlingRightsForPiece[piece]);
+      basicState.castlingRights = (CastlingRightsT) (basicState.castlingRights & ~lostCastlingRights);
+
+      board.zobristKey ^= CastlingRightsKeys[(size_t)color][lostCastlingRights];
+    }
+
+    // Pawns of the capturing color that could capture en-passant on the ep square of a pawn two-square push by pushColor.
+    // Same rule as Fen trimEp - we don't bother about pins and checks.
+    inline BitBoardT epCapturingPawnsBb(const ColorT pushColor, const SquareT epSquare, const BitBoardT capturingPawnsBb) {
+      const BitBoardT epSquareBb = bbForSquare(epSquare);
+      const BitBoardT pushedPawnBb = pushColor == White ? (epSquareBb << 8) : (epSquareBb >> 8);
+
+      return (((pushedPawnBb << 1) & ~FileA) | ((pushedPawnBb >> 1) & ~FileH)) & capturingPawnsBb;
+    }
+
+    inline ZobristKeyT epSquareKey(const ColorT pushColor, const SquareT epSquare, const BitBoardT capturingPawnsBb) {
+      return epCapturingPawnsBb(pushColor, epSquare, capturingPawnsBb) == BbNone ? 0 : EpSquareKeys[epSquare];
+    }
+
+    // Clear the en-passant square of your last move - it expires with my move.
+    // Must be done before moving my pawns since the Zobrist key only includes a capturable ep square.
+    template <typename BoardT, ColorT Color>
+    inline void clearEpSquare(BoardT& board) {
+      const ColorT OtherColor = OtherColorT<Color>::value;
+      NonPromosColorStateImplT& yourState = board.state[(size_t)OtherColor].basic;
+
+      board.zobristKey ^= epSquareKey(OtherColor, getEpSquare(yourState), board.state[(size_t)Color].basic.pawnsBb);
+
+      storeEpSquare(yourState, InvalidSquare);
+    }
+
+    // Set the en-passant square after a pawn two-square push - my own ep square is already clear.
+    template <typename BoardT, ColorT Color>
+    inline void setEpSquare(BoardT& board, const SquareT epSquare) {
+      const ColorT OtherColor = OtherColorT<Color>::value;
+
+      storeEpSquare(board.state[(size_t)Color].basic, epSquare);
+
+      board.zobristKey ^= epSquareKey(Color, epSquare, board.state[(size_t)OtherColor].basic.pawnsBb);
+    }
+
+    inline ZobristKeyT genPromoPiecesZobristKey(const ColorT color, const BasicColorStateImplT& colorState) {
+      // No promo pieces
+      return 0;
+    }
+
+    inline ZobristKeyT genPromoPiecesZobristKey(const ColorT color, const FullColorStateImplT& colorState) {
+      ZobristKeyT key = 0;
+
+      // Ugh the bit stuff operates on BitBoardT type
+      BitBoardT activePromos = (BitBoardT)colorState.promos.activePromos;
+      while(activePromos) {
+	const int promoIndex = Bits::popLsb(activePromos);
+	const PromoPieceAndSquareT promoPieceAndSquare = colorState.promos.promos[promoIndex];
+
+	key ^= PieceKeys[(size_t)color][PieceTypeForPromoPiece[promoPieceOf(promoPieceAndSquare)]][squareOf(promoPieceAndSquare)];
+      }
+
+      return key;
+    }
+
+    // Generate the Zobrist key from scratch - used when a board is set up other than by the copy-make functions.
+    template <typename BoardT>
+    inline ZobristKeyT genZobristKey(const BoardT& board) {
+      ZobristKeyT key = 0;
+
+      for(size_t color = 0; color < NColors; color++) {
+	const typename BoardT::ColorStateT& colorState = board.state[color];
+	const NonPromosColorStateImplT& basicState = colorState.basic;
+
+	BitBoardT pawnsBb = basicState.pawnsBb;
+	while(pawnsBb) {
+	  key ^= PieceKeys[color][Pawn][Bits::popLsb(pawnsBb)];
+	}
+
+	// PieceKeys for InvalidSquare are zero
+	for(PieceT piece = Knight1; piece < NPieces; piece = (PieceT)(piece+1)) {
+	  key ^= PieceKeys[color][PieceTypeForPiece[piece]][basicState.pieceSquares[piece]];
+	}
+
+	key ^= genPromoPiecesZobristKey((ColorT)color, colorState);
+
+	key ^= CastlingRightsKeys[color][basicState.castlingRights];
+
+	// At most one side has an ep square at any time
+	key ^= epSquareKey((ColorT)color, getEpSquare(basicState), board.state[(size_t)otherColor((ColorT)color)].basic.pawnsBb);
+      }
+
+      return key;
+    }
+
     template <typename BoardT, ColorT Color>
     inline PieceT removePiece(BoardT& board, const SquareT square, const PieceT piece) {
       typename BoardT::ColorStateT &colorState = board.state[(size_t)Color];
 
       colorState.basic.pieceSquares[piece] = InvalidSquare;
 
-      colorState.basic.castlingRights = (CastlingRightsT) (colorState.basic.castlingRights & ~CastlingRightsForPiece[piece]);
+      board.zobristKey ^= PieceKeys[(size_t)Color][PieceTypeForPiece[piece]][square];
+
+      updatePieceBbs(board, Color, PieceTypeForPiece[piece], bbForSquare(square));
+
+      removeCastlingRights<BoardT>(board, Color, piece);
       
       return piece;
     }
@@ -152,6 +335,10 @@ namespace Chess {
       const BitBoardT squareBb = bbForSquare(square);
 
       colorState.basic.pawnsBb &= ~squareBb;
+
+      board.zobristKey ^= PieceKeys[(size_t)Color][Pawn][square];
+
+      updatePieceBbs(board, Color, Pawn, squareBb);
     }
 
     template <typename BoardT, ColorT Color>
@@ -159,13 +346,16 @@ namespace Chess {
       typename BoardT::ColorStateT &colorState = board.state[(size_t)Color];
 
       colorState.promos.activePromos &= ~((u8)1 << promoIndex);
+
+      const PromoPieceAndSquareT promoPieceAndSquare = colorState.promos.promos[promoIndex];
+      board.zobristKey ^= PieceKeys[(size_t)Color][PieceTypeForPromoPiece[promoPieceOf(promoPieceAndSquare)]][squareOf(promoPieceAndSquare)];
     }
 
     template <typename BoardT, ColorT Color>
     inline PieceT removePiece(BoardT& board, const ColorPieceMapT& pieceMap, const SquareT square) {
       const PieceT piece = pieceMap.board[square].piece;
 
-      return removePiece<Color>(board, square, piece);
+      return removePiece<BoardT, Color>(board, square, piece);
     }
 
     template <typename BoardT, ColorT Color>
@@ -189,7 +379,13 @@ namespace Chess {
       const PieceT piece = pieceMap.board[square].piece; // NoPiece for pawns
       pieces.basic.pieceSquares[piece] = InvalidSquare;
 
-      pieces.basic.castlingRights = (CastlingRightsT) (pieces.basic.castlingRights & ~CastlingRightsForPiece[piece]);
+      // PieceKeys for NoPieceType are zero
+      const PieceTypeT pieceType = pawnBb != BbNone ? Pawn : PieceTypeForPiece[piece];
+      board.zobristKey ^= PieceKeys[(size_t)Color][pieceType][square];
+
+      updatePieceBbs(board, Color, pieceType, squareBb);
+
+      removeCastlingRights<BoardT>(board, Color, piece);
     }
 
     template <typename BoardT>
@@ -197,6 +393,10 @@ namespace Chess {
       typename BoardT::ColorStateT &colorState = board.state[(size_t)color];
 
       colorState.basic.pieceSquares[piece] = square;
+
+      board.zobristKey ^= PieceKeys[(size_t)color][PieceTypeForPiece[piece]][square];
+
+      updatePieceBbs(board, color, PieceTypeForPiece[piece], bbForSquare(square));
     }
 
     template <typename BoardT>
@@ -205,13 +405,19 @@ namespace Chess {
 
       colorState.promos.activePromos |= ((u8)1 << promoIndex);
       colorState.promos.promos[promoIndex] = promoPieceAndSquareOf(promoPiece, square);
+
+      board.zobristKey ^= PieceKeys[(size_t)color][PieceTypeForPromoPiece[promoPiece]][square];
     }
     
     template <typename BoardT>
     inline void movePromoPiece(BoardT& board, const ColorT color, const int promoIndex, const PromoPieceT promoPiece, const SquareT square) {
       typename BoardT::ColorStateT &colorState = board.state[(size_t)color];
 
+      const SquareT from = squareOf(colorState.promos.promos[promoIndex]);
       colorState.promos.promos[promoIndex] = promoPieceAndSquareOf(promoPiece, square);
+
+      const PieceTypeT pieceType = PieceTypeForPromoPiece[promoPiece];
+      board.zobristKey ^= PieceKeys[(size_t)color][pieceType][from] ^ PieceKeys[(size_t)color][pieceType][square];
     }
     
     template <typename BoardT, ColorT Color>
@@ -226,6 +432,10 @@ namespace Chess {
       const BitBoardT squareBb = bbForSquare(square);
 
       state.basic.pawnsBb |= squareBb;
+
+      board.zobristKey ^= PieceKeys[(size_t)color][Pawn][square];
+
+      updatePieceBbs(board, color, Pawn, squareBb);
     }
 
     template <typename BoardT, ColorT Color>
@@ -233,35 +443,142 @@ namespace Chess {
       placePawn<BoardT>(board, Color, square);
     }
 
+    //
+    // Moves
+    //
+    // Each move comes as makeXxx() which makes the move in place and returns an UndoT, unmakeXxx() which takes the
+    //   board back to how it was before makeXxx(), and the copy-make xxx() which is makeXxx() on a copy of the board.
+    // Unmake moves pieces back with the same primitives as make - which keeps BasicBbsBoardT piece bitboards straight
+    //   since they're xor-maintained - and restores the Zobrist key, castling rights and ep squares from the UndoT.
+    //
+
+    // What unmakeXxx() can't work out from the move itself
+    struct UndoT {
+      ZobristKeyT zobristKey;
+      CastlingRightsT myCastlingRights;
+      CastlingRightsT yourCastlingRights;
+      SquareT yourEpSquare;
+      // Promo index of the new promo piece for pawn promotions
+      u8 promoIndex;
+      // Captured promo piece - its promo slot can be re-used for your promotions further down the tree
+      PromoPieceAndSquareT capturedPromo;
+    };
+
     template <typename BoardT, ColorT Color>
-    inline BoardT pushPiece(const BoardT& oldBoard, PieceT piece, const SquareT from, const SquareT to) {
-      BoardT board = oldBoard;
+    inline UndoT genUndo(const BoardT& board) {
+      const NonPromosColorStateImplT& myState = board.state[(size_t)Color].basic;
+      const NonPromosColorStateImplT& yourState = board.state[(size_t)OtherColorT<Color>::value].basic;
+
+      UndoT undo;
+      undo.zobristKey = board.zobristKey;
+      undo.myCastlingRights = myState.castlingRights;
+      undo.yourCastlingRights = yourState.castlingRights;
+      undo.yourEpSquare = getEpSquare(yourState);
+      undo.promoIndex = 0;
+      undo.capturedPromo = 0;
+
+      return undo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void restoreUndo(BoardT& board, const UndoT& undo) {
+      NonPromosColorStateImplT& myState = board.state[(size_t)Color].basic;
+      NonPromosColorStateImplT& yourState = board.state[(size_t)OtherColorT<Color>::value].basic;
+
+      board.zobristKey = undo.zobristKey;
+      myState.castlingRights = undo.myCastlingRights;
+      yourState.castlingRights = undo.yourCastlingRights;
+      // My ep square is always clear before my move
+      storeEpSquare(myState, InvalidSquare);
+      storeEpSquare(yourState, undo.yourEpSquare);
+    }
+
+    // Undo removePieceOrPawn() - the piece map is from before the capture
+    template <typename BoardT, ColorT Color>
+    inline void replacePieceOrPawn(BoardT& board, const ColorPieceMapT& pieceMap, const SquareT square) {
+      const PieceT piece = pieceMap.board[square].piece; // NoPiece for pawns
+      if(piece == NoPiece) {
+	placePawn<BoardT, Color>(board, square);
+      } else {
+	placePiece<BoardT, Color>(board, square, piece);
+      }
+    }
+
+    // Save the promo piece that removePromoPiece() is about to take off the board
+    template <typename BoardT, ColorT Color>
+    inline void saveCapturedPromoPiece(UndoT& undo, const BoardT& board, const ColorPieceMapT& pieceMap, const SquareT square) {
+      undo.capturedPromo = board.state[(size_t)Color].promos.promos[pieceMap.board[square].promoIndex];
+    }
+
+    // Undo removePromoPiece() - the Zobrist key is restored separately
+    template <typename BoardT, ColorT Color>
+    inline void replacePromoPiece(BoardT& board, const UndoT& undo, const ColorPieceMapT& pieceMap, const SquareT square) {
+      typename BoardT::ColorStateT &colorState = board.state[(size_t)Color];
+      const int promoIndex = pieceMap.board[square].promoIndex;
+
+      colorState.promos.activePromos |= ((u8)1 << promoIndex);
+      colorState.promos.promos[promoIndex] = undo.capturedPromo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline UndoT makePushPiece(BoardT& board, PieceT piece, const SquareT from, const SquareT to) {
+      const UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
       removePiece<BoardT, Color>(board, from, piece);
 
       placePiece<BoardT, Color>(board, to, piece);
 
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
-      return board;
+      return undo;
     }
 
     template <typename BoardT, ColorT Color>
-    inline BoardT pushPromoPiece(const BoardT& oldBoard, const int promoIndex, const PromoPieceT promoPiece, const SquareT to) {
+    inline void unmakePushPiece(BoardT& board, const UndoT& undo, PieceT piece, const SquareT from, const SquareT to) {
+      removePiece<BoardT, Color>(board, to, piece);
+
+      placePiece<BoardT, Color>(board, from, piece);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT pushPiece(const BoardT& oldBoard, PieceT piece, const SquareT from, const SquareT to) {
       BoardT board = oldBoard;
+      makePushPiece<BoardT, Color>(board, piece, from, to);
+      return board;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline UndoT makePushPromoPiece(BoardT& board, const int promoIndex, const PromoPieceT promoPiece, const SquareT to) {
+      const UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
       movePromoPiece<BoardT>(board, Color, promoIndex, promoPiece, to);
 
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
+      return undo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void unmakePushPromoPiece(BoardT& board, const UndoT& undo, const int promoIndex, const PromoPieceT promoPiece, const SquareT from) {
+      movePromoPiece<BoardT>(board, Color, promoIndex, promoPiece, from);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT pushPromoPiece(const BoardT& oldBoard, const int promoIndex, const PromoPieceT promoPiece, const SquareT to) {
+      BoardT board = oldBoard;
+      makePushPromoPiece<BoardT, Color>(board, promoIndex, promoPiece, to);
       return board;
     }
     
     template <typename BoardT, ColorT Color>
-    inline BoardT captureWithPiece(const BoardT& oldBoard, PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
-      BoardT board = oldBoard;
+    inline UndoT makeCaptureWithPiece(BoardT& board, PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      const UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
       removePieceOrPawn<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
 
@@ -269,59 +586,125 @@ namespace Chess {
 
       placePiece<BoardT, Color>(board, to, piece);
 
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
+      return undo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void unmakeCaptureWithPiece(BoardT& board, const UndoT& undo, PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      removePiece<BoardT, Color>(board, to, piece);
+
+      placePiece<BoardT, Color>(board, from, piece);
+
+      replacePieceOrPawn<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT captureWithPiece(const BoardT& oldBoard, PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      BoardT board = oldBoard;
+      makeCaptureWithPiece<BoardT, Color>(board, piece, yourPieceMap, from, to);
       return board;
     }
     
     template <typename BoardT, ColorT Color>
-    inline BoardT capturePromoPieceWithPiece(const BoardT& oldBoard, PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
-      BoardT board = oldBoard;
+    inline UndoT makeCapturePromoPieceWithPiece(BoardT& board, PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
+      saveCapturedPromoPiece<BoardT, OtherColorT<Color>::value>(undo, board, yourPieceMap, to);
       removePromoPiece<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
       
       removePiece<BoardT, Color>(board, from, piece);
 
       placePiece<BoardT, Color>(board, to, piece);
 
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
+      return undo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void unmakeCapturePromoPieceWithPiece(BoardT& board, const UndoT& undo, PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      removePiece<BoardT, Color>(board, to, piece);
+
+      placePiece<BoardT, Color>(board, from, piece);
+
+      replacePromoPiece<BoardT, OtherColorT<Color>::value>(board, undo, yourPieceMap, to);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT capturePromoPieceWithPiece(const BoardT& oldBoard, PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      BoardT board = oldBoard;
+      makeCapturePromoPieceWithPiece<BoardT, Color>(board, piece, yourPieceMap, from, to);
       return board;
     }
     
     template <typename BoardT, ColorT Color>
-    inline BoardT captureWithPromoPiece(const BoardT& oldBoard, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
-      BoardT board = oldBoard;
+    inline UndoT makeCaptureWithPromoPiece(BoardT& board, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      const UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
       removePieceOrPawn<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
 
       movePromoPiece<BoardT>(board, Color, promoIndex, promoPiece, to);
 
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
+      return undo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void unmakeCaptureWithPromoPiece(BoardT& board, const UndoT& undo, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      movePromoPiece<BoardT>(board, Color, promoIndex, promoPiece, from);
+
+      replacePieceOrPawn<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT captureWithPromoPiece(const BoardT& oldBoard, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      BoardT board = oldBoard;
+      makeCaptureWithPromoPiece<BoardT, Color>(board, promoIndex, promoPiece, yourPieceMap, from, to);
       return board;
     }
     
     template <typename BoardT, ColorT Color>
-    inline BoardT capturePromoPieceWithPromoPiece(const BoardT& oldBoard, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
-      BoardT board = oldBoard;
+    inline UndoT makeCapturePromoPieceWithPromoPiece(BoardT& board, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
+      saveCapturedPromoPiece<BoardT, OtherColorT<Color>::value>(undo, board, yourPieceMap, to);
       removePromoPiece<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
 
       movePromoPiece<BoardT>(board, Color, promoIndex, promoPiece, to);
 
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
+      return undo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void unmakeCapturePromoPieceWithPromoPiece(BoardT& board, const UndoT& undo, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      movePromoPiece<BoardT>(board, Color, promoIndex, promoPiece, from);
+
+      replacePromoPiece<BoardT, OtherColorT<Color>::value>(board, undo, yourPieceMap, to);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT capturePromoPieceWithPromoPiece(const BoardT& oldBoard, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      BoardT board = oldBoard;
+      makeCapturePromoPieceWithPromoPiece<BoardT, Color>(board, promoIndex, promoPiece, yourPieceMap, from, to);
       return board;
     }
     
     template <typename BoardT, ColorT Color>
-    inline BoardT captureWithPawn(const BoardT& oldBoard, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
-      BoardT board = oldBoard;
+    inline UndoT makeCaptureWithPawn(BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      const UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
       removePieceOrPawn<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
 
@@ -329,15 +712,32 @@ namespace Chess {
 
       placePawn<BoardT, Color>(board, to);
 
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
-      return board;
+      return undo;
     }
 
     template <typename BoardT, ColorT Color>
-    inline BoardT captureWithPawnToPromo(const BoardT& oldBoard, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+    inline void unmakeCaptureWithPawn(BoardT& board, const UndoT& undo, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      removePawn<BoardT, Color>(board, to);
+
+      placePawn<BoardT, Color>(board, from);
+
+      replacePieceOrPawn<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT captureWithPawn(const BoardT& oldBoard, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
       BoardT board = oldBoard;
+      makeCaptureWithPawn<BoardT, Color>(board, yourPieceMap, from, to);
+      return board;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline UndoT makeCaptureWithPawnToPromo(BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+      UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
       removePieceOrPawn<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
 
@@ -345,49 +745,104 @@ namespace Chess {
 
       const int promoIndex = Bits::lsb(~board.state[(size_t)Color].promos.activePromos);
       addPromoPiece<BoardT>(board, Color, promoIndex, promoPiece, to);
+      undo.promoIndex = (u8)promoIndex;
 
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
+      return undo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void unmakeCaptureWithPawnToPromo(BoardT& board, const UndoT& undo, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+      removePromoPiece<BoardT, Color>(board, undo.promoIndex);
+
+      placePawn<BoardT, Color>(board, from);
+
+      replacePieceOrPawn<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT captureWithPawnToPromo(const BoardT& oldBoard, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+      BoardT board = oldBoard;
+      makeCaptureWithPawnToPromo<BoardT, Color>(board, yourPieceMap, from, to, promoPiece);
       return board;
     }
     
     template <typename BoardT, ColorT Color>
-    inline BoardT capturePromoPieceWithPawn(const BoardT& oldBoard, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
-      BoardT board = oldBoard;
+    inline UndoT makeCapturePromoPieceWithPawn(BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
+      saveCapturedPromoPiece<BoardT, OtherColorT<Color>::value>(undo, board, yourPieceMap, to);
       removePromoPiece<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
 
       removePawn<BoardT, Color>(board, from);
 
       placePawn<BoardT, Color>(board, to);
       
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
+      return undo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void unmakeCapturePromoPieceWithPawn(BoardT& board, const UndoT& undo, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      removePawn<BoardT, Color>(board, to);
+
+      placePawn<BoardT, Color>(board, from);
+
+      replacePromoPiece<BoardT, OtherColorT<Color>::value>(board, undo, yourPieceMap, to);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT capturePromoPieceWithPawn(const BoardT& oldBoard, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+      BoardT board = oldBoard;
+      makeCapturePromoPieceWithPawn<BoardT, Color>(board, yourPieceMap, from, to);
       return board;
     }
     
     template <typename BoardT, ColorT Color>
-    inline BoardT capturePromoPieceWithPawnToPromo(const BoardT& oldBoard, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
-      BoardT board = oldBoard;
+    inline UndoT makeCapturePromoPieceWithPawnToPromo(BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+      UndoT undo = genUndo<BoardT, Color>(board);
 
+      clearEpSquare<BoardT, Color>(board);
+
+      saveCapturedPromoPiece<BoardT, OtherColorT<Color>::value>(undo, board, yourPieceMap, to);
       removePromoPiece<BoardT, OtherColorT<Color>::value>(board, yourPieceMap, to);
 
       removePawn<BoardT, Color>(board, from);
 
       const int promoIndex = Bits::lsb(~board.state[(size_t)Color].promos.activePromos);
       addPromoPiece<BoardT>(board, Color, promoIndex, promoPiece, to);
+      undo.promoIndex = (u8)promoIndex;
       
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
+      return undo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void unmakeCapturePromoPieceWithPawnToPromo(BoardT& board, const UndoT& undo, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+      removePromoPiece<BoardT, Color>(board, undo.promoIndex);
+
+      placePawn<BoardT, Color>(board, from);
+
+      replacePromoPiece<BoardT, OtherColorT<Color>::value>(board, undo, yourPieceMap, to);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT capturePromoPieceWithPawnToPromo(const BoardT& oldBoard, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+      BoardT board = oldBoard;
+      makeCapturePromoPieceWithPawnToPromo<BoardT, Color>(board, yourPieceMap, from, to, promoPiece);
       return board;
     }
 
     template <typename BoardT, ColorT Color, bool IsPawnPushTwo = false>
-    inline BoardT pushPawn(const BoardT& oldBoard, const SquareT from, const SquareT to) {
-      BoardT board = oldBoard;
+    inline UndoT makePushPawn(BoardT& board, const SquareT from, const SquareT to) {
+      const UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
       removePawn<BoardT, Color>(board, from);
 
@@ -395,32 +850,64 @@ namespace Chess {
 
       // Set en-passant square
       if(IsPawnPushTwo) {
-      	board.state[(size_t)Color].basic.epSquare = (SquareT)((from+to)/2);
-      } else {
-      	board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      }	
+	setEpSquare<BoardT, Color>(board, (SquareT)((from+to)/2));
+      }
       
-      return board;
+      return undo;
     }
 
     template <typename BoardT, ColorT Color>
-    inline BoardT pushPawnToPromo(const BoardT& oldBoard, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+    inline void unmakePushPawn(BoardT& board, const UndoT& undo, const SquareT from, const SquareT to) {
+      removePawn<BoardT, Color>(board, to);
+
+      placePawn<BoardT, Color>(board, from);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color, bool IsPawnPushTwo = false>
+    inline BoardT pushPawn(const BoardT& oldBoard, const SquareT from, const SquareT to) {
       BoardT board = oldBoard;
+      makePushPawn<BoardT, Color, IsPawnPushTwo>(board, from, to);
+      return board;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline UndoT makePushPawnToPromo(BoardT& board, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+      UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
       removePawn<BoardT, Color>(board, from);
 
       const int promoIndex = Bits::lsb(~board.state[(size_t)Color].promos.activePromos);
       addPromoPiece<BoardT>(board, Color, promoIndex, promoPiece, to);
+      undo.promoIndex = (u8)promoIndex;
 
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
+      return undo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void unmakePushPawnToPromo(BoardT& board, const UndoT& undo, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+      removePromoPiece<BoardT, Color>(board, undo.promoIndex);
+
+      placePawn<BoardT, Color>(board, from);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT pushPawnToPromo(const BoardT& oldBoard, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+      BoardT board = oldBoard;
+      makePushPawnToPromo<BoardT, Color>(board, from, to, promoPiece);
       return board;
     }
     
     template <typename BoardT, ColorT Color>
-    inline BoardT captureEp(const BoardT& oldBoard, const SquareT from, const SquareT to, const SquareT captureSquare) {
-      BoardT board = oldBoard;
+    inline UndoT makeCaptureEp(BoardT& board, const SquareT from, const SquareT to, const SquareT captureSquare) {
+      const UndoT undo = genUndo<BoardT, Color>(board);
+
+      clearEpSquare<BoardT, Color>(board);
 
       removePawn<BoardT, OtherColorT<Color>::value>(board, captureSquare);
 
@@ -428,9 +915,24 @@ namespace Chess {
 
       placePawn<BoardT, Color>(board, to);
 
-      // Clear en-passant square
-      board.state[(size_t)Color].basic.epSquare = InvalidSquare;
-      
+      return undo;
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void unmakeCaptureEp(BoardT& board, const UndoT& undo, const SquareT from, const SquareT to, const SquareT captureSquare) {
+      removePawn<BoardT, Color>(board, to);
+
+      placePawn<BoardT, Color>(board, from);
+
+      placePawn<BoardT, OtherColorT<Color>::value>(board, captureSquare);
+
+      restoreUndo<BoardT, Color>(board, undo);
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline BoardT captureEp(const BoardT& oldBoard, const SquareT from, const SquareT to, const SquareT captureSquare) {
+      BoardT board = oldBoard;
+      makeCaptureEp<BoardT, Color>(board, from, to, captureSquare);
       return board;
     }
 
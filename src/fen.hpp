@@ -132,7 +132,8 @@ namespace Chess {
       return castlingRights;
     }
 
-    inline SquareT parseEpSquare(const std::string& ep) {
+    // The ep square is behind the pawn that just pushed two - so on the 6th rank if White is to move, else the 3rd
+    inline SquareT parseEpSquare(const std::string& ep, const ColorT colorToMove) {
       if(ep == "-") {
 	return InvalidSquare;
       }
@@ -152,6 +153,9 @@ namespace Chess {
 	throw std::invalid_argument("Invalid FEN en-passant rank - expecting 1-8");
       }
       int rank = rankC - '1';
+      if(rank != (colorToMove == White ? 5 : 2)) {
+	throw std::invalid_argument(colorToMove == White ? "Invalid FEN en-passant rank - expecting 6 with White to move" : "Invalid FEN en-passant rank - expecting 3 with Black to move");
+      }
 
       return squareOf(rank, (int)file);
     }
@@ -339,7 +343,7 @@ namespace Chess {
       auto castlingRights = parseCastlingRights(fields[2]);
 
       // EP square
-      SquareT epSquare = parseEpSquare(fields[3]);
+      SquareT epSquare = parseEpSquare(fields[3], color);
       
       BasicBoardT board = BoardUtils::emptyBoard();
 
@@ -348,7 +352,9 @@ namespace Chess {
       board.state[(size_t)White].basic.castlingRights = castlingRights[White];
       board.state[(size_t)Black].basic.castlingRights = castlingRights[Black];
 
-      board.state[(size_t)otherColor(color)].basic.epSquare = epSquare;
+      storeEpSquare(board.state[(size_t)otherColor(color)].basic, epSquare);
+
+      board.zobristKey = genZobristKey(board);
       
       return std::make_pair(board, color);
     }
@@ -410,7 +416,7 @@ namespace Chess {
 
     template <typename BoardT>
     inline std::string genEpSquare(const BoardT& board, const ColorT colorToMove, const bool trimEp) {
-      SquareT epSq = board.state[(size_t)otherColor(colorToMove)].basic.epSquare;
+      SquareT epSq = getEpSquare(board.state[(size_t)otherColor(colorToMove)].basic);
       if(trimEp) {
 	const BitBoardT myPawnsBb = board.state[(size_t)colorToMove].basic.pawnsBb;
 	const BitBoardT epSquarePawnAttackersBb = MoveGen::PawnAttackerBbs[(size_t)colorToMove][epSq];
@@ -0,0 +1,386 @@
+#ifndef LOCKLESS_HASH_MAP_HPP
+#define LOCKLESS_HASH_MAP_HPP
+
+// Fixed-size lock-free hash map keyed on a 64-bit hash (typically the Zobrist key)
+//
+// All memory is allocated up front as a power-of-two number of cache-line aligned buckets.
+// Entries are validated with the 'lockless hashing' trick - we store key ^ (xor of all value words) alongside the value,
+//   so a torn read racing with a writer fails the key check and looks like a miss. Lost writes are fine for a cache.
+// When a bucket is full we evict the entry with the lowest weight - e.g. the smallest subtree for perft - so expensive
+//   entries survive and cheap ones churn. If the new entry is lighter than all of them it is dropped instead.
+// Each entry is also stamped with the generation of the run that last wrote or hit it, in the top bits of the check
+//   word - so only 56 bits of the key are checked. Entries from older generations are evicted first whatever their
+//   weight, so that a table carried over from earlier runs doesn't turn into a read-only cache of old positions.
+//
+// The map can optionally be backed by a file via mmap so that it persists across runs.
+// The file starts with a one cache line header holding the key and value scheme versions supplied by the caller,
+//   the table geometry, and a checksum of the table which is written on clean shutdown.
+// If the process is killed the table is left marked unclean, but since every entry is self-validating we still
+//   trust it on the next run - only the checksum check is skipped. Any version or geometry mismatch resets the table.
+// The header also holds the generation, which is bumped each time the table is reused.
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "types.hpp"
+
+namespace Chess {
+
+  namespace LocklessHashMap {
+
+    const size_t CacheLineSize = 64;
+
+    template <typename ValT>
+    struct LocklessHashMapEntryT {
+      static_assert(sizeof(ValT) % sizeof(u64) == 0, "lockless hash map values must be a whole number of u64's");
+      static const size_t NWords = sizeof(ValT) / sizeof(u64);
+
+      // key ^ words[0] ^ ... ^ words[NWords-1]
+      std::atomic<u64> check;
+      std::atomic<u64> words[NWords];
+    };
+
+    // A bucket is the fewest whole cache lines that hold an entry, packed with as many entries as fit.
+    // So small entries share a cache line and get weighted replacement, while an entry bigger than half a cache line
+    //   gets a bucket to itself - two of them would straddle three cache lines on every probe.
+    template <typename ValT>
+    struct LocklessHashMapBucketT {
+      typedef LocklessHashMapEntryT<ValT> EntryT;
+      static const size_t NCacheLines = (sizeof(EntryT) + CacheLineSize - 1) / CacheLineSize;
+      static const size_t NEntries = NCacheLines * CacheLineSize / sizeof(EntryT);
+
+      alignas(CacheLineSize) EntryT entries[NEntries];
+    };
+
+    // E.g. 4 nodes-only perft entries in one cache line, or one full stats perft entry in two
+    static_assert(sizeof(LocklessHashMapBucketT<u64>) == CacheLineSize && LocklessHashMapBucketT<u64>::NEntries == 4, "one word values should pack 4 entries per cache line bucket");
+    static_assert(sizeof(LocklessHashMapBucketT<u64[10]>) == 2*CacheLineSize && LocklessHashMapBucketT<u64[10]>::NEntries == 1, "values over half a cache line should get one entry per whole cache line bucket");
+
+    const u64 LocklessHashMapFileMagic = 0x70616d6873616873ULL; // "shashmap"
+    // Bump this if the file layout changes
+    const u64 LocklessHashMapFileFormatVersion = 3;
+
+    // Generation lives in the top bits of each entry's check word - it is never 0 so a used entry is never all zero
+    const int GenerationShift = 56;
+    const u64 KeyCheckMask = (1ULL << GenerationShift) - 1;
+    const u64 MaxGeneration = 255;
+
+    // Exactly one cache line so that the buckets that follow are cache line aligned
+    struct LocklessHashMapFileHeaderT {
+      u64 magic;
+      u64 format_version;
+      u64 key_scheme;
+      u64 val_scheme;
+      u64 entry_size;
+      u64 n_buckets;
+      u32 is_clean;
+      u32 generation;
+      u64 checksum;
+    };
+
+    static_assert(sizeof(LocklessHashMapFileHeaderT) == CacheLineSize, "lockless hash map file header must be one cache line");
+
+    // Default weight function - all entries are equal so we evict the first full entry
+    template <typename ValT>
+    struct NoWeightFn {
+      static u64 fn(const ValT& val) { return 0; }
+    };
+
+    template <typename ValT, typename WeightFnT = NoWeightFn<ValT>>
+    class LocklessHashMap {
+      typedef LocklessHashMapEntryT<ValT> EntryT;
+      typedef LocklessHashMapBucketT<ValT> BucketT;
+      static const size_t NWords = EntryT::NWords;
+      static const size_t NEntries = BucketT::NEntries;
+
+      size_t n_buckets;
+      size_t bucket_mask;
+      BucketT* buckets;
+
+      // File backing - fd is -1 for an anonymous in-memory map
+      int fd;
+      void* mapping;
+      size_t mapping_bytes;
+      bool loaded;
+
+      // Stamped on entries as they are written or hit - 1 for an in-memory map
+      u64 generation;
+
+      // Non-copyable - we own a (possibly very large) slab of memory
+      LocklessHashMap(const LocklessHashMap&) = delete;
+      LocklessHashMap& operator=(const LocklessHashMap&) = delete;
+
+      // Largest power of two number of buckets that fits in max_bytes - at least one bucket
+      static size_t n_buckets_for_size(const size_t max_bytes) {
+	static_assert(sizeof(BucketT) == BucketT::NCacheLines * CacheLineSize, "lockless hash map buckets must be whole cache lines");
+	size_t n = 1;
+	while(2*n*sizeof(BucketT) <= max_bytes) {
+	  n *= 2;
+	}
+	return n;
+      }
+
+      // Returns the (low 56 bits of the) key that was stored in the entry, the value in words, and the entry's generation
+      static u64 load_entry(const EntryT& entry, u64 (&words)[NWords], u64& entry_generation) {
+	const u64 check = entry.check.load(std::memory_order_relaxed);
+	u64 key = check;
+	for(size_t i = 0; i < NWords; i++) {
+	  words[i] = entry.words[i].load(std::memory_order_relaxed);
+	  key ^= words[i];
+	}
+	entry_generation = check >> GenerationShift;
+	return key & KeyCheckMask;
+      }
+
+      u64 check_for(const u64 key, const u64 (&words)[NWords]) const {
+	u64 check = key;
+	for(size_t i = 0; i < NWords; i++) {
+	  check ^= words[i];
+	}
+	return (check & KeyCheckMask) | (generation << GenerationShift);
+      }
+
+      static bool is_empty(const EntryT& entry) {
+	u64 bits = entry.check.load(std::memory_order_relaxed);
+	for(size_t i = 0; i < NWords; i++) {
+	  bits |= entry.words[i].load(std::memory_order_relaxed);
+	}
+	return bits == 0;
+      }
+
+      BucketT& bucket_for_key(const u64 key) const {
+	return buckets[key & bucket_mask];
+      }
+
+      LocklessHashMapFileHeaderT* header() const {
+	return static_cast<LocklessHashMapFileHeaderT*>(mapping);
+      }
+
+      static void throw_errno(const std::string& what, const std::string& file_path) {
+	throw std::runtime_error(what + " '" + file_path + "': " + strerror(errno));
+      }
+
+      // Not thread-safe w.r.t. concurrent accessors
+      u64 checksum() const {
+	u64 sum = 0;
+	for(size_t b = 0; b < n_buckets; b++) {
+	  for(size_t e = 0; e < NEntries; e++) {
+	    const EntryT& entry = buckets[b].entries[e];
+	    sum = (sum << 7 | sum >> 57) ^ entry.check.load(std::memory_order_relaxed);
+	    for(size_t i = 0; i < NWords; i++) {
+	      sum = (sum << 7 | sum >> 57) ^ entry.words[i].load(std::memory_order_relaxed);
+	    }
+	  }
+	}
+	return sum;
+      }
+
+      // Map the file, re-initialising it unless it holds a compatible table
+      void open_file(const std::string& file_path, const u64 key_scheme, const u64 val_scheme) {
+	fd = open(file_path.c_str(), O_RDWR | O_CREAT, 0644);
+	if(fd < 0) {
+	  throw_errno("Failed to open hash map file", file_path);
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0) {
+	  throw_errno("Failed to stat hash map file", file_path);
+	}
+
+	mapping_bytes = sizeof(LocklessHashMapFileHeaderT) + n_buckets * sizeof(BucketT);
+	const bool is_right_size = (size_t)st.st_size == mapping_bytes;
+	if(!is_right_size && ftruncate(fd, mapping_bytes) != 0) {
+	  throw_errno("Failed to size hash map file", file_path);
+	}
+
+	mapping = mmap(0, mapping_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(mapping == MAP_FAILED) {
+	  mapping = 0;
+	  throw_errno("Failed to mmap hash map file", file_path);
+	}
+	buckets = reinterpret_cast<BucketT*>(static_cast<char*>(mapping) + sizeof(LocklessHashMapFileHeaderT));
+
+	LocklessHashMapFileHeaderT& h = *header();
+	loaded = is_right_size &&
+	  h.magic == LocklessHashMapFileMagic &&
+	  h.format_version == LocklessHashMapFileFormatVersion &&
+	  h.key_scheme == key_scheme &&
+	  h.val_scheme == val_scheme &&
+	  h.entry_size == sizeof(EntryT) &&
+	  h.n_buckets == n_buckets &&
+	  h.generation != 0 &&
+	  (!h.is_clean || h.checksum == checksum());
+
+	// A new generation for this run - older entries become the first to go
+	generation = loaded ? h.generation % MaxGeneration + 1 : 1;
+
+	if(!loaded) {
+	  // A new file is already zero
+	  if(st.st_size != 0) {
+	    clear();
+	  }
+	  h.magic = LocklessHashMapFileMagic;
+	  h.format_version = LocklessHashMapFileFormatVersion;
+	  h.key_scheme = key_scheme;
+	  h.val_scheme = val_scheme;
+	  h.entry_size = sizeof(EntryT);
+	  h.n_buckets = n_buckets;
+	}
+	h.generation = (u32)generation;
+
+	// Until we close cleanly
+	h.is_clean = 0;
+	h.checksum = 0;
+	msync(mapping, sizeof(LocklessHashMapFileHeaderT), MS_SYNC);
+      }
+
+      void close_file() {
+	LocklessHashMapFileHeaderT& h = *header();
+	h.checksum = checksum();
+	h.is_clean = 1;
+	msync(mapping, mapping_bytes, MS_SYNC);
+	munmap(mapping, mapping_bytes);
+	close(fd);
+      }
+
+    public:
+      LocklessHashMap(const size_t max_bytes) :
+	n_buckets(n_buckets_for_size(max_bytes)), bucket_mask(n_buckets - 1), buckets(0), fd(-1), mapping(0), mapping_bytes(0), loaded(false), generation(1) {
+	void* mem = 0;
+	if(posix_memalign(&mem, CacheLineSize, n_buckets * sizeof(BucketT)) != 0) {
+	  throw std::bad_alloc();
+	}
+	buckets = static_cast<BucketT*>(mem);
+	clear();
+      }
+
+      // File-backed map - the table is loaded from the file if it was written with the same schemes and size.
+      LocklessHashMap(const size_t max_bytes, const std::string& file_path, const u64 key_scheme, const u64 val_scheme) :
+	n_buckets(n_buckets_for_size(max_bytes)), bucket_mask(n_buckets - 1), buckets(0), fd(-1), mapping(0), mapping_bytes(0), loaded(false), generation(1) {
+	try {
+	  open_file(file_path, key_scheme, val_scheme);
+	} catch(...) {
+	  if(mapping) {
+	    munmap(mapping, mapping_bytes);
+	  }
+	  if(fd >= 0) {
+	    close(fd);
+	  }
+	  throw;
+	}
+      }
+
+      ~LocklessHashMap() {
+	if(fd >= 0) {
+	  close_file();
+	} else {
+	  free(buckets);
+	}
+      }
+
+      // True iff the table was loaded from an existing file
+      bool is_loaded() const { return loaded; }
+
+      size_t size_in_bytes() const { return n_buckets * sizeof(BucketT); }
+
+      size_t capacity() const { return n_buckets * NEntries; }
+
+      // Not thread-safe w.r.t. concurrent accessors
+      void clear() {
+	for(size_t b = 0; b < n_buckets; b++) {
+	  for(size_t e = 0; e < NEntries; e++) {
+	    EntryT& entry = buckets[b].entries[e];
+	    entry.check.store(0, std::memory_order_relaxed);
+	    for(size_t i = 0; i < NWords; i++) {
+	      entry.words[i].store(0, std::memory_order_relaxed);
+	    }
+	  }
+	}
+      }
+
+      bool copy_if_present(const u64 key, ValT& to) const noexcept {
+	BucketT& bucket = bucket_for_key(key);
+
+	for(size_t e = 0; e < NEntries; e++) {
+	  u64 words[NWords];
+	  u64 entry_generation;
+	  if(load_entry(bucket.entries[e], words, entry_generation) == (key & KeyCheckMask)) {
+	    memcpy(&to, words, sizeof(ValT));
+	    // Still useful so bring it into this generation - if this races with a writer the entry just looks torn
+	    if(entry_generation != generation) {
+	      bucket.entries[e].check.store(check_for(key, words), std::memory_order_relaxed);
+	    }
+	    return true; // found
+	  }
+	}
+
+	return false; // not present (or torn)
+      }
+
+      void put(const u64 key, const ValT& val) noexcept {
+	BucketT& bucket = bucket_for_key(key);
+
+	// Overwrite an existing entry for the key, else an empty entry, else the lowest weight entry from an older
+	//   generation, else the lowest weight entry
+	size_t victim = 0;
+	bool isFull = true;
+	bool isVictimStale = false;
+	u64 victimWeight = ~(u64)0;
+	for(size_t e = 0; e < NEntries; e++) {
+	  u64 words[NWords];
+	  u64 entry_generation;
+	  if(load_entry(bucket.entries[e], words, entry_generation) == (key & KeyCheckMask)) {
+	    victim = e;
+	    isFull = false;
+	    break;
+	  }
+	  if(is_empty(bucket.entries[e])) {
+	    victim = e;
+	    isFull = false;
+	    victimWeight = 0;
+	  } else if(isFull) {
+	    ValT entryVal;
+	    memcpy(&entryVal, words, sizeof(ValT));
+	    const u64 weight = WeightFnT::fn(entryVal);
+	    const bool isStale = entry_generation != generation;
+	    if((isStale && !isVictimStale) || (isStale == isVictimStale && weight < victimWeight)) {
+	      victim = e;
+	      isVictimStale = isStale;
+	      victimWeight = weight;
+	    }
+	  }
+	}
+
+	// Don't evict an entry from this generation that is more expensive than the new one
+	if(isFull && !isVictimStale && WeightFnT::fn(val) < victimWeight) {
+	  return;
+	}
+
+	u64 words[NWords];
+	memcpy(words, &val, sizeof(ValT));
+
+	EntryT& entry = bucket.entries[victim];
+	for(size_t i = 0; i < NWords; i++) {
+	  entry.words[i].store(words[i], std::memory_order_relaxed);
+	}
+	entry.check.store(check_for(key, words), std::memory_order_relaxed);
+      }
+
+    };
+
+  } // namespace LocklessHashMap
+
+} // namespace Chess
+
+#endif //ndef LOCKLESS_HASH_MAP_HPP
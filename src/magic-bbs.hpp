@@ -0,0 +1,86 @@
+#ifndef MAGIC_BBS_HPP
+#define MAGIC_BBS_HPP
+
+// Generated by src/tools/find-magics.cpp - do not edit
+
+#include "types.hpp"
+
+namespace Chess {
+
+  namespace MoveGen {
+
+    const BitBoardT RookMagicBbMultipliers[64+1] = {
+      0x2580008220104000ull, 0x0440002000100044ull, 0x2900140841002000ull, 0x4480080080041000ull,
+      0x0200050200882010ull, 0x8480040080220021ull, 0xc880010000802200ull, 0x4080002040800100ull,
+      0x0004800040008420ull, 0x0000804000200080ull, 0x3010801008842000ull, 0x0000800800801002ull,
+      0x0040800400080080ull, 0x0084804400020080ull, 0x8404000402100108ull, 0x0460800041000080ull,
+      0x0040808000204000ull, 0x0000484000201000ull, 0x2610820020120040ull, 0x0020120022004009ull,
+      0x0008818024000800ull, 0x4101818004000200ull, 0x0080040002080110ull, 0x4100120010608104ull,
+      0x2000802180004003ull, 0x9c00802200420101ull, 0x0000220200108442ull, 0x0030002100090010ull,
+      0x0000c80280040080ull, 0x2002400801200410ull, 0x1000010400884210ull, 0x0c80104a00028403ull,
+      0x0040400080800022ull, 0x0240804001802000ull, 0x0060004800401002ull, 0x2001000821001000ull,
+      0x0000800800800402ull, 0x2000800200800400ull, 0x1180020001010004ull, 0x0000008042000401ull,
+      0x032040048c218000ull, 0x4100400081130020ull, 0x0148200011010040ull, 0x8000120008220040ull,
+      0x208b000800110004ull, 0x0008020004008080ull, 0xc040018822040030ull, 0x0009000080410022ull,
+      0x0120a58012400080ull, 0x1022400091022300ull, 0x0002600090028480ull, 0x0086084010a20200ull,
+      0x8800802400080280ull, 0x0000020080040080ull, 0x0904210810920400ull, 0x1004a04081240200ull,
+      0x0109004080102202ull, 0x4003220900401082ull, 0x0820010040100c21ull, 0x0001002208041001ull,
+      0x0041006208001005ull, 0x0001001802040031ull, 0x0010020108100084ull, 0x0080408041040022ull,
+      0x0, // InvalidSquare
+    };
+
+    const u8 RookMagicBbIndexBits[64+1] = {
+      12, 11, 11, 11, 11, 11, 11, 12,
+      11, 10, 10, 10, 10, 10, 10, 11,
+      11, 10, 10, 10, 10, 10, 10, 11,
+      11, 10, 10, 10, 10, 10, 10, 11,
+      11, 10, 10, 10, 10, 10, 10, 11,
+      11, 10, 10, 10, 10, 10, 10, 11,
+      11, 10, 10, 10, 10, 10, 10, 11,
+      12, 11, 11, 11, 11, 11, 11, 12,
+      0 // InvalidSquare
+    };
+
+    // Sum of 2^RookMagicBbIndexBits plus one entry for InvalidSquare
+    const size_t RookMagicBbTableSize = 102400 + 1;
+
+    const BitBoardT BishopMagicBbMultipliers[64+1] = {
+      0x0050020801140410ull, 0x0512020843070301ull, 0xa032080e02202480ull, 0x0804410022a10021ull,
+      0x000404200000010cull, 0x2800880440000802ull, 0x2001010190400000ull, 0x0082108888084000ull,
+      0x1200482011040130ull, 0x1884820242040900ull, 0x0000040114011000ull, 0x0100040502119800ull,
+      0x0900640420000080ull, 0x8020010402c00001ull, 0x0001205402084060ull, 0x24000a0100884500ull,
+      0x6085044008080120ull, 0x0850402214180090ull, 0x0202201000220221ull, 0x0001032020418080ull,
+      0x8002800400a0500bull, 0x0042000241100980ull, 0x81005002a2082008ull, 0x008100208408c208ull,
+      0x4048044140042800ull, 0x0024b00104111800ull, 0x000a080021004400ull, 0x0104040020401080ull,
+      0x0206840241802005ull, 0x0402020008880900ull, 0x08040400088a2104ull, 0x0008520408410410ull,
+      0x0012a84082201200ull, 0x000f011140085000ull, 0x0082080400060960ull, 0x1802020080080080ull,
+      0x0004040400001100ull, 0x0110044200024100ull, 0x2002244401810080ull, 0x8022021349220148ull,
+      0x4904100988200400ull, 0x0001864110582041ull, 0x8000201410000200ull, 0x0001402018004108ull,
+      0x0040021022100400ull, 0x0082200421a03100ull, 0x80084f0404824410ull, 0x0002809502000900ull,
+      0x0008441008080018ull, 0x00e0410410020024ull, 0x00b0021100880002ull, 0x0020006484041402ull,
+      0x0022004005044011ull, 0x196020c470008002ull, 0x222002820224000cull, 0x8121010c01004c00ull,
+      0x0008144210104804ull, 0x0800202401080800ull, 0x0080101050441000ull, 0x2800100480420880ull,
+      0x80502080a0042400ull, 0x8105000404080212ull, 0x002844450c180200ull, 0x1002900112088202ull,
+      0x0, // InvalidSquare
+    };
+
+    const u8 BishopMagicBbIndexBits[64+1] = {
+       6,  5,  5,  5,  5,  5,  5,  6,
+       5,  5,  5,  5,  5,  5,  5,  5,
+       5,  5,  7,  7,  7,  7,  5,  5,
+       5,  5,  7,  9,  9,  7,  5,  5,
+       5,  5,  7,  9,  9,  7,  5,  5,
+       5,  5,  7,  7,  7,  7,  5,  5,
+       5,  5,  5,  5,  5,  5,  5,  5,
+       6,  5,  5,  5,  5,  5,  5,  6,
+      0 // InvalidSquare
+    };
+
+    // Sum of 2^BishopMagicBbIndexBits plus one entry for InvalidSquare
+    const size_t BishopMagicBbTableSize = 5248 + 1;
+
+  } // namespace MoveGen
+
+} // namespace Chess
+
+#endif //ndef MAGIC_BBS_HPP
@@ -17,6 +17,98 @@ namespace Chess {
     struct PosTag {};
     struct CountTag {};
 
+    // Which stats does the consumer want?
+    // NodesOnlyStatsT compiles out all of the capture/check/checkmate bookkeeping, including generation of the check masks.
+    struct AllStatsT { static const bool NodesOnly = false; };
+    struct NodesOnlyStatsT { static const bool NodesOnly = true; };
+
+    //
+    // Copy-make or make/unmake?
+    //
+    // By default each move is made on a fresh copy of the board which is handed to the pos handler.
+    // A pos handler that declares 'typedef MakeUnmakeTag MoveModeT;' instead gets the move made in place on the parent
+    //   board, which is unmade again once handlePos() returns. The undo record lives in the calling stack frame so each
+    //   thread has its own undo stack for free.
+    // In make/unmake mode the board passed to makeAllLegalMoves() must be a mutable object, and the handler must not
+    //   hold on to the board after handlePos() returns - copy it if needed.
+    // The move handlers only see const BoardT& so make/unmake const_cast's it back - that is only defined behaviour if
+    //   every board object in the chain is non-const. So every board that gets handed on to a pos handler - the perft
+    //   root, the copy-make child and the FullBoardT/BasicBoardT upgrade and demotion copies - is a non-const local.
+    // NOTHING CHECKS THIS - a const board handed to a make/unmake pos handler compiles fine and is undefined behaviour.
+    //
+
+    struct CopyMakeTag {};
+    struct MakeUnmakeTag {};
+
+    template <typename T>
+    struct VoidType { typedef void type; };
+
+    template <typename PosHandlerT, typename = void>
+    struct MoveModeType {
+      typedef CopyMakeTag MoveModeT;
+    };
+
+    template <typename PosHandlerT>
+    struct MoveModeType<PosHandlerT, typename VoidType<typename PosHandlerT::MoveModeT>::type> {
+      typedef typename PosHandlerT::MoveModeT MoveModeT;
+    };
+
+    template <typename ReversePosHandlerT, typename MoveFnT, typename StateT, typename BoardT, typename... ArgsT>
+    inline void makeMoveAndHandlePos(const CopyMakeTag&, StateT state, const BoardT& board, const MoveInfoT moveInfo, const ArgsT&... args) {
+      // Non-const - see above
+      BoardT newBoard = MoveFnT::fn(board, args...);
+
+      ReversePosHandlerT::handlePos(state, newBoard, moveInfo);
+    }
+
+    template <typename ReversePosHandlerT, typename MoveFnT, typename StateT, typename BoardT, typename... ArgsT>
+    inline void makeMoveAndHandlePos(const MakeUnmakeTag&, StateT state, const BoardT& board, const MoveInfoT moveInfo, const ArgsT&... args) {
+      // Unchecked - only safe if the board object itself is non-const - see above
+      BoardT& mutableBoard = const_cast<BoardT&>(board);
+
+      const UndoT undo = MoveFnT::make(mutableBoard, args...);
+
+      ReversePosHandlerT::handlePos(state, board, moveInfo);
+
+      MoveFnT::unmake(mutableBoard, undo, args...);
+    }
+
+    template <typename ReversePosHandlerT, typename MoveFnT, typename StateT, typename BoardT, typename... ArgsT>
+    inline void makeMoveAndHandlePos(StateT state, const BoardT& board, const MoveInfoT moveInfo, const ArgsT&... args) {
+      typedef typename MoveModeType<ReversePosHandlerT>::MoveModeT MoveModeT;
+
+      makeMoveAndHandlePos<ReversePosHandlerT, MoveFnT>(MoveModeT(), state, board, moveInfo, args...);
+    }
+
+    //
+    // Demotion from FullBoardT back to BasicBoardT
+    //
+    // Once the last promo piece of either color has been captured there's no point staying on the slower FullBoardT.
+    // Promo piece captures use PromoPieceCapturePosHandlerT<PosHandlerT> in place of PosHandlerT - the generic move
+    //   handlers only ever use its ReverseT, which hands the new position to WithoutPromosT when it has no promos left.
+    //
+
+    template <typename PosHandlerT>
+    struct DemotingPosHandlerT {
+      typedef typename MoveModeType<PosHandlerT>::MoveModeT MoveModeT;
+
+      template <typename StateT>
+      inline static void handlePos(StateT state, const FullBoardT& board, MoveInfoT moveInfo) {
+	if((board.state[(size_t)White].promos.activePromos | board.state[(size_t)Black].promos.activePromos) == 0) {
+	  // Non-const - make/unmake will make moves in place on it
+	  BasicBoardT basicBoard = copyBoard<BasicBoardT, FullBoardT>(board);
+	  PosHandlerT::WithoutPromosT::handlePos(state, basicBoard, moveInfo);
+	} else {
+	  PosHandlerT::handlePos(state, board, moveInfo);
+	}
+      }
+    };
+
+    template <typename PosHandlerT>
+    struct PromoPieceCapturePosHandlerT {
+      typedef DemotingPosHandlerT<typename PosHandlerT::ReverseT> ReverseT;
+    };
+
     //
     // Non-promo pawn moves
     //
@@ -39,6 +131,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
 	return captureWithPawn<BoardT, Color>(board, yourPieceMap, from, to);
       }
+      static UndoT make(BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	return makeCaptureWithPawn<BoardT, Color>(board, yourPieceMap, from, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	unmakeCaptureWithPawn<BoardT, Color>(board, undo, yourPieceMap, from, to);
+      }
     };
 
     template <typename BoardT, ColorT Color> struct PawnMoveFn<BoardT, Color, PawnPromoCapture, ColorPieceMapT> {
@@ -46,6 +144,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
 	return capturePromoPieceWithPawn<BoardT, Color>(board, yourPieceMap, from, to);
       }
+      static UndoT make(BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	return makeCapturePromoPieceWithPawn<BoardT, Color>(board, yourPieceMap, from, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	unmakeCapturePromoPieceWithPawn<BoardT, Color>(board, undo, yourPieceMap, from, to);
+      }
     };
 
     template <typename StateT, typename PosHandlerT, typename BoardT, ColorT Color, PawnMove::DirT Dir, typename PawnMoveFn, MoveTypeT MoveType>
@@ -56,12 +160,10 @@ namespace Chess {
 	const SquareT to = Bits::popLsb(pawnsMoveBb);
 	const SquareT from = PawnMove::to2FromSq<Color, Dir>(to);
 
-	const BoardT newBoard = PawnMoveFn::fn(board, yourPieceMap, from, to);
-
 	const bool isDirectCheck = (bbForSquare(to) & directChecksBb) != BbNone;
 	const bool isDiscoveredCheck = (bbForSquare(from) & discoveriesBb) != BbNone;
 	
-	ReversePosHandlerT::handlePos(state, newBoard, MoveInfoT(MoveType, Pawn, from, to, isDirectCheck, isDiscoveredCheck));
+	makeMoveAndHandlePos<ReversePosHandlerT, PawnMoveFn>(state, board, MoveInfoT(MoveType, Pawn, from, to, isDirectCheck, isDiscoveredCheck), yourPieceMap, from, to);
       }
     }
 
@@ -85,6 +187,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const NoPieceMapT&, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
 	return pushPawnToPromo<BoardT, Color>(board, from, to, promoPiece);
       }
+      static UndoT make(BoardT& board, const NoPieceMapT&, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+	return makePushPawnToPromo<BoardT, Color>(board, from, to, promoPiece);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const NoPieceMapT&, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+	unmakePushPawnToPromo<BoardT, Color>(board, undo, from, to, promoPiece);
+      }
     };
 
     template <typename BoardT, ColorT Color> struct PawnPromoMoveFn<BoardT, Color, PawnCaptureToPromo, ColorPieceMapT> {
@@ -92,6 +200,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
     	return captureWithPawnToPromo<BoardT, Color>(board, yourPieceMap, from, to, promoPiece);
       }
+      static UndoT make(BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+	return makeCaptureWithPawnToPromo<BoardT, Color>(board, yourPieceMap, from, to, promoPiece);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+	unmakeCaptureWithPawnToPromo<BoardT, Color>(board, undo, yourPieceMap, from, to, promoPiece);
+      }
     };
 
     template <typename BoardT, ColorT Color> struct PawnPromoMoveFn<BoardT, Color, PawnPromoCaptureToPromo, ColorPieceMapT> {
@@ -99,6 +213,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
     	return capturePromoPieceWithPawnToPromo<BoardT, Color>(board, yourPieceMap, from, to, promoPiece);
       }
+      static UndoT make(BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+	return makeCapturePromoPieceWithPawnToPromo<BoardT, Color>(board, yourPieceMap, from, to, promoPiece);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to, PromoPieceT promoPiece) {
+	unmakeCapturePromoPieceWithPawnToPromo<BoardT, Color>(board, undo, yourPieceMap, from, to, promoPiece);
+      }
     };
 
     template <typename StateT, typename PosHandlerT, typename BoardT, ColorT Color, PawnMove::DirT Dir, typename PawnPromoMoveFn, MoveTypeT MoveType>
@@ -132,24 +252,33 @@ namespace Chess {
 	  }
 	}
 	
-	const BoardT queenPromoBoard = PawnPromoMoveFn::fn(board, yourPieceMap, from, to, PromoQueen);
 	const bool isQueenCheck = isOrthogCheck || isDiagCheck;
-	ReversePosHandlerT::handlePos(state, queenPromoBoard, MoveInfoT(MoveType, Queen, from, to, isQueenCheck, isDiscoveredCheck, /*isPromo*/true));
+	makeMoveAndHandlePos<ReversePosHandlerT, PawnPromoMoveFn>(state, board, MoveInfoT(MoveType, Queen, from, to, isQueenCheck, isDiscoveredCheck, /*isPromo*/true), yourPieceMap, from, to, PromoQueen);
 	
-	const BoardT knightPromoBoard = PawnPromoMoveFn::fn(board, yourPieceMap, from, to, PromoKnight);
 	const bool isKnightCheck = (MoveGen::KnightAttacks[yourKingSq] & toBb) != BbNone;
-	ReversePosHandlerT::handlePos(state, knightPromoBoard, MoveInfoT(MoveType, Knight, from, to, isKnightCheck, isDiscoveredCheck, /*isPromo*/true));
+	makeMoveAndHandlePos<ReversePosHandlerT, PawnPromoMoveFn>(state, board, MoveInfoT(MoveType, Knight, from, to, isKnightCheck, isDiscoveredCheck, /*isPromo*/true), yourPieceMap, from, to, PromoKnight);
 	
-	const BoardT rookPromoBoard = PawnPromoMoveFn::fn(board, yourPieceMap, from, to, PromoRook);
 	const bool isRookCheck = isOrthogCheck;
-	ReversePosHandlerT::handlePos(state, rookPromoBoard, MoveInfoT(MoveType, Rook, from, to, isRookCheck, isDiscoveredCheck, /*isPromo*/true));
+	makeMoveAndHandlePos<ReversePosHandlerT, PawnPromoMoveFn>(state, board, MoveInfoT(MoveType, Rook, from, to, isRookCheck, isDiscoveredCheck, /*isPromo*/true), yourPieceMap, from, to, PromoRook);
 	
-	const BoardT bishopPromoBoard = PawnPromoMoveFn::fn(board, yourPieceMap, from, to, PromoBishop);
 	const bool isBishopCheck = isDiagCheck;
-	ReversePosHandlerT::handlePos(state, bishopPromoBoard, MoveInfoT(MoveType, Bishop, from, to, isBishopCheck, isDiscoveredCheck, /*isPromo*/true));
+	makeMoveAndHandlePos<ReversePosHandlerT, PawnPromoMoveFn>(state, board, MoveInfoT(MoveType, Bishop, from, to, isBishopCheck, isDiscoveredCheck, /*isPromo*/true), yourPieceMap, from, to, PromoBishop);
       }
     }
 
+    template <typename BoardT, ColorT Color, bool IsPushTwo>
+    struct PawnPushMoveFn {
+      static BoardT fn(const BoardT& board, const SquareT from, const SquareT to) {
+	return pushPawn<BoardT, Color, IsPushTwo>(board, from, to);
+      }
+      static UndoT make(BoardT& board, const SquareT from, const SquareT to) {
+	return makePushPawn<BoardT, Color, IsPushTwo>(board, from, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const SquareT from, const SquareT to) {
+	unmakePushPawn<BoardT, Color>(board, undo, from, to);
+      }
+    };
+
     template <typename StateT, typename PosHandlerT, typename BoardT, ColorT Color, PawnMove::DirT Dir, bool IsPushTwo>
     inline void handlePawnsNonPromoPush(StateT state, const BoardT& board, BitBoardT pawnsPushBb, const BitBoardT directChecksBb, const BitBoardT discoveriesBb) {
       typedef typename PosHandlerT::ReverseT ReversePosHandlerT;
@@ -158,12 +287,10 @@ namespace Chess {
 	const SquareT to = Bits::popLsb(pawnsPushBb);
 	const SquareT from = PawnMove::to2FromSq<Color, Dir>(to);
 
-	const BoardT newBoard = pushPawn<BoardT, Color, IsPushTwo>(board, from, to);
-
 	const bool isDirectCheck = (bbForSquare(to) & directChecksBb) != BbNone;
 	const bool isDiscoveredCheck = (bbForSquare(from) & discoveriesBb) != BbNone;
 	
-	ReversePosHandlerT::handlePos(state, newBoard, MoveInfoT(PushMove, Pawn, from, to, isDirectCheck, isDiscoveredCheck));
+	makeMoveAndHandlePos<ReversePosHandlerT, PawnPushMoveFn<BoardT, Color, IsPushTwo>>(state, board, MoveInfoT(PushMove, Pawn, from, to, isDirectCheck, isDiscoveredCheck), from, to);
       }
     }
 
@@ -175,8 +302,8 @@ namespace Chess {
 
     template <typename StateT, typename PosHandlerT, ColorT Color, PawnMove::DirT Dir, bool IsPushTwo>
     inline void handlePawnsPromoPush(StateT state, const BasicBoardT& board, BitBoardT pawnsPushBb, const BitBoardT directChecksBb, const BitBoardT discoveriesBb, const BitBoardT yourKingRookAttacksBb, const BitBoardT yourKingBishopAttacksBb) {
-      // Upgrade to FullBoardT
-      const FullBoardT boardWithPromos = copyBoard<FullBoardT, BasicBoardT>(board);
+      // Upgrade to FullBoardT - non-const since make/unmake will make moves in place on it
+      FullBoardT boardWithPromos = copyBoard<FullBoardT, BasicBoardT>(board);
 
       handlePawnsPromoPush<StateT, typename PosHandlerT::WithPromosT, Color, Dir, IsPushTwo>(state, boardWithPromos, pawnsPushBb, directChecksBb, discoveriesBb, yourKingRookAttacksBb, yourKingBishopAttacksBb);
     }
@@ -192,7 +319,7 @@ namespace Chess {
       BitBoardT promoPieceCapturesBb = pawnsCaptureBb & yourPieceMap.allPromoPiecesBb;
 	
       typedef PawnMoveFn<FullBoardT, Color, PawnPromoCapture, ColorPieceMapT> PawnPromoCaptureFn;
-      handlePawnsMove<StateT, PosHandlerT, FullBoardT, Color, Dir, PawnPromoCaptureFn, CaptureMove>(state, board, yourPieceMap, promoPieceCapturesBb, directChecksBb, discoveriesBb);
+      handlePawnsMove<StateT, PromoPieceCapturePosHandlerT<PosHandlerT>, FullBoardT, Color, Dir, PawnPromoCaptureFn, CaptureMove>(state, board, yourPieceMap, promoPieceCapturesBb, directChecksBb, discoveriesBb);
 	
       return pawnsCaptureBb & ~promoPieceCapturesBb;
     }
@@ -224,14 +351,27 @@ namespace Chess {
 
     template <typename StateT, typename PosHandlerT, ColorT Color, PawnMove::DirT Dir>
     inline void handlePawnsPromoCapture(StateT state, const BasicBoardT& board, const ColorPieceMapT& yourPieceMap, BitBoardT pawnsCaptureBb, const BitBoardT directChecksBb, const BitBoardT discoveriesBb, const BitBoardT yourKingRookAttacksBb, const BitBoardT yourKingBishopAttacksBb) {
-      // Upgrade to FullBoardT
-      const FullBoardT boardWithPromos = copyBoard<FullBoardT, BasicBoardT>(board);
+      // Upgrade to FullBoardT - non-const since make/unmake will make moves in place on it
+      FullBoardT boardWithPromos = copyBoard<FullBoardT, BasicBoardT>(board);
 
       // No capture of promo pieces to consider, so just handle capture of non-promo pieces
       typedef PawnPromoMoveFn<FullBoardT, Color, PawnCaptureToPromo, ColorPieceMapT> PawnCaptureToPromoFn;
       handlePawnsMoveToPromo<StateT, typename PosHandlerT::WithPromosT, FullBoardT, Color, Dir, PawnCaptureToPromoFn, CaptureMove>(state, boardWithPromos, yourPieceMap, pawnsCaptureBb, directChecksBb, discoveriesBb, yourKingRookAttacksBb, yourKingBishopAttacksBb);
     }
 
+    template <typename BoardT, ColorT Color>
+    struct PawnEpCaptureMoveFn {
+      static BoardT fn(const BoardT& board, const SquareT from, const SquareT to, const SquareT captureSq) {
+	return captureEp<BoardT, Color>(board, from, to, captureSq);
+      }
+      static UndoT make(BoardT& board, const SquareT from, const SquareT to, const SquareT captureSq) {
+	return makeCaptureEp<BoardT, Color>(board, from, to, captureSq);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const SquareT from, const SquareT to, const SquareT captureSq) {
+	unmakeCaptureEp<BoardT, Color>(board, undo, from, to, captureSq);
+      }
+    };
+
     template <typename StateT, typename PosHandlerT, typename BoardT, ColorT Color, PawnMove::DirT Dir>
     inline void handlePawnEpCapture(StateT state, const BoardT& board, BitBoardT pawnsEpCaptureBb, const BitBoardT directChecksBb, const BitBoardT discoveriesBb, const bool isEpDiscovery) {
       typedef typename PosHandlerT::ReverseT ReversePosHandlerT;
@@ -242,12 +382,10 @@ namespace Chess {
 	const SquareT from = PawnMove::to2FromSq<Color, Dir>(to);
 	const SquareT captureSq = PawnMove::to2FromSq<Color, PawnMove::PushOne>(to);
 
-	const BoardT newBoard = captureEp<BoardT, Color>(board, from, to, captureSq);
-
 	const bool isDirectCheck = (bbForSquare(to) & directChecksBb) != BbNone;
 	const bool isDiscoveredCheck = isEpDiscovery || (bbForSquare(from) & discoveriesBb) != BbNone;
 	
-	ReversePosHandlerT::handlePos(state, newBoard, MoveInfoT(EpCaptureMove, Pawn, from, to, isDirectCheck, isDiscoveredCheck));
+	makeMoveAndHandlePos<ReversePosHandlerT, PawnEpCaptureMoveFn<BoardT, Color>>(state, board, MoveInfoT(EpCaptureMove, Pawn, from, to, isDirectCheck, isDiscoveredCheck), from, to, captureSq);
       }
     }
 
@@ -722,6 +860,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const PieceT piece, const NoPieceMapT&, const SquareT from, const SquareT to) {
 	return pushPiece<BoardT, Color>(board, piece, from, to);
       }
+      static UndoT make(BoardT& board, const PieceT piece, const NoPieceMapT&, const SquareT from, const SquareT to) {
+	return makePushPiece<BoardT, Color>(board, piece, from, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const PieceT piece, const NoPieceMapT&, const SquareT from, const SquareT to) {
+	unmakePushPiece<BoardT, Color>(board, undo, piece, from, to);
+      }
     };
 
     template <typename BoardT, ColorT Color> struct PieceMoveFn<BoardT, Color, PieceCapture, ColorPieceMapT> {
@@ -729,6 +873,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
 	return captureWithPiece<BoardT, Color>(board, piece, yourPieceMap, from, to);
       }
+      static UndoT make(BoardT& board, const PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	return makeCaptureWithPiece<BoardT, Color>(board, piece, yourPieceMap, from, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	unmakeCaptureWithPiece<BoardT, Color>(board, undo, piece, yourPieceMap, from, to);
+      }
     };
 
     template <typename BoardT, ColorT Color> struct PieceMoveFn<BoardT, Color, PiecePromoCapture, ColorPieceMapT> {
@@ -736,6 +886,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
 	return capturePromoPieceWithPiece<BoardT, Color>(board, piece, yourPieceMap, from, to);
       }
+      static UndoT make(BoardT& board, const PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	return makeCapturePromoPieceWithPiece<BoardT, Color>(board, piece, yourPieceMap, from, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const PieceT piece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	unmakeCapturePromoPieceWithPiece<BoardT, Color>(board, undo, piece, yourPieceMap, from, to);
+      }
     };
 
     template <typename StateT, typename PosHandlerT, typename BoardT, ColorT Color, typename PieceMoveFn, MoveTypeT MoveType>
@@ -745,11 +901,9 @@ namespace Chess {
       while(toBb) {
 	const SquareT to = Bits::popLsb(toBb);
 
-	const BoardT newBoard = PieceMoveFn::fn(board, piece, yourPieceMap, from, to);
-
 	const bool isDirectCheck = (bbForSquare(to) & directChecksBb) != BbNone;
 	
-	ReversePosHandlerT::handlePos(state, newBoard, MoveInfoT(MoveType, PieceTypeForPiece[piece], from, to, isDirectCheck, isDiscoveredCheck));
+	makeMoveAndHandlePos<ReversePosHandlerT, PieceMoveFn>(state, board, MoveInfoT(MoveType, PieceTypeForPiece[piece], from, to, isDirectCheck, isDiscoveredCheck), piece, yourPieceMap, from, to);
       }
     }
     
@@ -765,7 +919,7 @@ namespace Chess {
 
       // (Non-promo-)piece captures of promo pieces
       typedef PieceMoveFn<FullBoardT, Color, PiecePromoCapture, ColorPieceMapT> PiecePromoCaptureFn;
-      handlePieceMoves<StateT, PosHandlerT, FullBoardT, Color, PiecePromoCaptureFn, CaptureMove>(state, board, piece, yourPieceMap, from, promoPieceCapturesBb, directChecksBb, isDiscoveredCheck);
+      handlePieceMoves<StateT, PromoPieceCapturePosHandlerT<PosHandlerT>, FullBoardT, Color, PiecePromoCaptureFn, CaptureMove>(state, board, piece, yourPieceMap, from, promoPieceCapturesBb, directChecksBb, isDiscoveredCheck);
 
       return pieceCapturesBb & ~promoPieceCapturesBb;
     }
@@ -895,6 +1049,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const NoPieceMapT&, const SquareT from, const SquareT to) {
 	return pushPiece<BoardT, Color>(board, TheKing, from, to);
       }
+      static UndoT make(BoardT& board, const NoPieceMapT&, const SquareT from, const SquareT to) {
+	return makePushPiece<BoardT, Color>(board, TheKing, from, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const NoPieceMapT&, const SquareT from, const SquareT to) {
+	unmakePushPiece<BoardT, Color>(board, undo, TheKing, from, to);
+      }
     };
 
     template <typename BoardT, ColorT Color> struct KingMoveFn<BoardT, Color, KingCapture, ColorPieceMapT> {
@@ -902,6 +1062,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
 	return captureWithPiece<BoardT, Color>(board, TheKing, yourPieceMap, from, to);
       }
+      static UndoT make(BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	return makeCaptureWithPiece<BoardT, Color>(board, TheKing, yourPieceMap, from, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	unmakeCaptureWithPiece<BoardT, Color>(board, undo, TheKing, yourPieceMap, from, to);
+      }
     };
 
     template <typename BoardT, ColorT Color> struct KingMoveFn<BoardT, Color, KingPromoCapture, ColorPieceMapT> {
@@ -909,6 +1075,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
 	return capturePromoPieceWithPiece<BoardT, Color>(board, TheKing, yourPieceMap, from, to);
       }
+      static UndoT make(BoardT& board, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	return makeCapturePromoPieceWithPiece<BoardT, Color>(board, TheKing, yourPieceMap, from, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	unmakeCapturePromoPieceWithPiece<BoardT, Color>(board, undo, TheKing, yourPieceMap, from, to);
+      }
     };
 
     template <typename StateT, typename PosHandlerT, typename BoardT, ColorT Color, typename KingMoveFn, MoveTypeT MoveType>
@@ -921,11 +1093,9 @@ namespace Chess {
 	const SquareT to = Bits::popLsb(toBb);
 	const BitBoardT toBb = bbForSquare(to);
 
-	const BoardT newBoard = KingMoveFn::fn(board, yourPieceMap, from, to);
-
 	const bool isDiscoveredCheck = (fromBb & discoveriesBb) != BbNone && (toBb & yourKingRaysBb) == BbNone;
 	
-	ReversePosHandlerT::handlePos(state, newBoard, MoveInfoT(MoveType, King, from, to, false/*isDirectCheck*/, isDiscoveredCheck));
+	makeMoveAndHandlePos<ReversePosHandlerT, KingMoveFn>(state, board, MoveInfoT(MoveType, King, from, to, false/*isDirectCheck*/, isDiscoveredCheck), yourPieceMap, from, to);
       }
     }
     
@@ -941,7 +1111,7 @@ namespace Chess {
       
       // King captures of promo pieces
       typedef KingMoveFn<FullBoardT, Color, KingPromoCapture, ColorPieceMapT> KingPromoCaptureFn;
-      handleKingMoves<StateT, PosHandlerT, FullBoardT, Color, KingPromoCaptureFn, CaptureMove>(state, board, yourPieceMap, from, promoPieceCapturesBb, discoveriesBb, yourKingRaysBb);
+      handleKingMoves<StateT, PromoPieceCapturePosHandlerT<PosHandlerT>, FullBoardT, Color, KingPromoCaptureFn, CaptureMove>(state, board, yourPieceMap, from, promoPieceCapturesBb, discoveriesBb, yourKingRaysBb);
 
       return kingCapturesBb & ~promoPieceCapturesBb;
     }
@@ -1065,6 +1235,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const int promoIndex, const PromoPieceT promoPiece, const NoPieceMapT&, const SquareT from, const SquareT to) {
 	return pushPromoPiece<BoardT, Color>(board, promoIndex, promoPiece, to);
       }
+      static UndoT make(BoardT& board, const int promoIndex, const PromoPieceT promoPiece, const NoPieceMapT&, const SquareT from, const SquareT to) {
+	return makePushPromoPiece<BoardT, Color>(board, promoIndex, promoPiece, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const int promoIndex, const PromoPieceT promoPiece, const NoPieceMapT&, const SquareT from, const SquareT to) {
+	unmakePushPromoPiece<BoardT, Color>(board, undo, promoIndex, promoPiece, from);
+      }
     };
 
     template <typename BoardT, ColorT Color> struct PromoPieceMoveFn<BoardT, Color, PromoPieceCapture, ColorPieceMapT> {
@@ -1072,6 +1248,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
 	return captureWithPromoPiece<BoardT, Color>(board, promoIndex, promoPiece, yourPieceMap, from, to);
       }
+      static UndoT make(BoardT& board, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	return makeCaptureWithPromoPiece<BoardT, Color>(board, promoIndex, promoPiece, yourPieceMap, from, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	unmakeCaptureWithPromoPiece<BoardT, Color>(board, undo, promoIndex, promoPiece, yourPieceMap, from, to);
+      }
     };
 
     template <typename BoardT, ColorT Color> struct PromoPieceMoveFn<BoardT, Color, PromoPiecePromoCapture, ColorPieceMapT> {
@@ -1079,6 +1261,12 @@ namespace Chess {
       static BoardT fn(const BoardT& board, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
 	return capturePromoPieceWithPromoPiece<BoardT, Color>(board, promoIndex, promoPiece, yourPieceMap, from, to);
       }
+      static UndoT make(BoardT& board, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	return makeCapturePromoPieceWithPromoPiece<BoardT, Color>(board, promoIndex, promoPiece, yourPieceMap, from, to);
+      }
+      static void unmake(BoardT& board, const UndoT& undo, const int promoIndex, const PromoPieceT promoPiece, const ColorPieceMapT& yourPieceMap, const SquareT from, const SquareT to) {
+	unmakeCapturePromoPieceWithPromoPiece<BoardT, Color>(board, undo, promoIndex, promoPiece, yourPieceMap, from, to);
+      }
     };
 
     template <typename StateT, typename PosHandlerT, typename BoardT, ColorT Color, typename PromoPieceMoveFn, MoveTypeT MoveType>
@@ -1088,11 +1276,9 @@ namespace Chess {
       while(toBb) {
 	const SquareT to = Bits::popLsb(toBb);
 	
-	const BoardT newBoard = PromoPieceMoveFn::fn(board, promoIndex, promoPiece, yourPieceMap, from, to);
-	
 	const bool isDirectCheck = (bbForSquare(to) & directChecksBb) != BbNone;
 	
-	ReversePosHandlerT::handlePos(state, newBoard, MoveInfoT(MoveType, PieceTypeForPromoPiece[promoPiece], from, to, isDirectCheck, isDiscoveredCheck));
+	makeMoveAndHandlePos<ReversePosHandlerT, PromoPieceMoveFn>(state, board, MoveInfoT(MoveType, PieceTypeForPromoPiece[promoPiece], from, to, isDirectCheck, isDiscoveredCheck), promoIndex, promoPiece, yourPieceMap, from, to);
       }
     }
 
@@ -1185,15 +1371,32 @@ namespace Chess {
     // Castling moves
     //
 
+    template <typename BoardT, ColorT Color, CastlingRightsT CastlingRight>
+    struct CastlingMoveFn {
+      typedef MoveGen::CastlingTraitsT<Color, CastlingRight> CastlingTraitsT;
+      
+      static BoardT fn(const BoardT& board) {
+	const BoardT newBoard1 = pushPiece<BoardT, Color>(board, TheKing, CastlingTraitsT::KingFrom, CastlingTraitsT::KingTo);
+	return pushPiece<BoardT, Color>(newBoard1, CastlingTraitsT::TheRook, CastlingTraitsT::RookFrom, CastlingTraitsT::RookTo);
+      }
+      static UndoT make(BoardT& board) {
+	const UndoT undo = makePushPiece<BoardT, Color>(board, TheKing, CastlingTraitsT::KingFrom, CastlingTraitsT::KingTo);
+	makePushPiece<BoardT, Color>(board, CastlingTraitsT::TheRook, CastlingTraitsT::RookFrom, CastlingTraitsT::RookTo);
+	return undo;
+      }
+      // Both unmakes restore the pre-castling state from the King move's undo
+      static void unmake(BoardT& board, const UndoT& undo) {
+	unmakePushPiece<BoardT, Color>(board, undo, CastlingTraitsT::TheRook, CastlingTraitsT::RookFrom, CastlingTraitsT::RookTo);
+	unmakePushPiece<BoardT, Color>(board, undo, TheKing, CastlingTraitsT::KingFrom, CastlingTraitsT::KingTo);
+      }
+    };
+
     template <typename StateT, typename PosHandlerT, typename BoardT, ColorT Color, CastlingRightsT CastlingRight>
     inline void handleCastlingMove(const PosTag&, StateT state, const BoardT& board, const bool isDiscoveredCheck) {
-      const BoardT newBoard1 = pushPiece<BoardT, Color>(board, TheKing, MoveGen::CastlingTraitsT<Color, CastlingRight>::KingFrom, MoveGen::CastlingTraitsT<Color, CastlingRight>::KingTo);
-      const BoardT newBoard = pushPiece<BoardT, Color>(newBoard1, MoveGen::CastlingTraitsT<Color, CastlingRight>::TheRook, MoveGen::CastlingTraitsT<Color, CastlingRight>::RookFrom, MoveGen::CastlingTraitsT<Color, CastlingRight>::RookTo);
-
       typedef typename PosHandlerT::ReverseT ReversePosHandlerT;
  
       // We use the king (from and) to square by convention
-      ReversePosHandlerT::handlePos(state, newBoard, MoveInfoT(CastlingMove, King, MoveGen::CastlingTraitsT<Color, CastlingRight>::KingFrom, MoveGen::CastlingTraitsT<Color, CastlingRight>::KingTo, /*isDirectCheck*/false, isDiscoveredCheck));
+      makeMoveAndHandlePos<ReversePosHandlerT, CastlingMoveFn<BoardT, Color, CastlingRight>>(state, board, MoveInfoT(CastlingMove, King, MoveGen::CastlingTraitsT<Color, CastlingRight>::KingFrom, MoveGen::CastlingTraitsT<Color, CastlingRight>::KingTo, /*isDirectCheck*/false, isDiscoveredCheck));
     }
 
     template <typename StateT, typename CountHandlerT, typename BoardT, ColorT Color, CastlingRightsT CastlingRight>
@@ -1227,6 +1430,11 @@ namespace Chess {
       return BbNone;
     }
 
+    template <>
+    inline BitBoardT getAllPromoPiecesBb<BasicBbsBoardT>(const typename MoveGen::ColorPieceBbsImplType<BasicBbsBoardT>::ColorPieceBbsT& pieceBbs) {
+      return BbNone;
+    }
+
     template <>
     inline BitBoardT getAllPromoPiecesBb<FullBoardT>(const typename MoveGen::ColorPieceBbsImplType<FullBoardT>::ColorPieceBbsT& pieceBbs) {
       return pieceBbs.allPromoPiecesBb;
@@ -1271,7 +1479,30 @@ namespace Chess {
       }
     }
     
-    template <typename StateT, typename PosOrCountTag, typename PosOrCountHandlerT, typename BoardT, ColorT Color>
+    // The to-squares of all legal moves except en-passant - the piece map is only needed if these include a capture.
+    template <typename LegalMovesT>
+    inline BitBoardT getAllNonPromoPieceMovesBb(const LegalMovesT& legalMoves) {
+      BitBoardT allMovesBb = legalMoves.pawnMoves.capturesLeftBb | legalMoves.pawnMoves.capturesRightBb;
+      for(int piece = Knight1; piece < NPieces; piece++) {
+	allMovesBb |= legalMoves.pieceMoves[piece];
+      }
+      return allMovesBb;
+    }
+
+    inline BitBoardT getAllMovesBb(const typename MoveGen::LegalMovesImplType<BasicBoardT>::LegalMovesT& legalMoves) {
+      return getAllNonPromoPieceMovesBb(legalMoves);
+    }
+
+    inline BitBoardT getAllMovesBb(const typename MoveGen::LegalMovesImplType<FullBoardT>::LegalMovesT& legalMoves) {
+      // Inactive promo indexes have no moves
+      BitBoardT allMovesBb = getAllNonPromoPieceMovesBb(legalMoves);
+      for(int promoIndex = 0; promoIndex < NPawns; promoIndex++) {
+	allMovesBb |= legalMoves.promoPieceMoves[promoIndex];
+      }
+      return allMovesBb;
+    }
+
+    template <typename StateT, typename PosOrCountTag, typename PosOrCountHandlerT, typename BoardT, ColorT Color, typename StatsT>
     inline void handleAllLegalMoves(StateT state, const BoardT& board) {
       typedef typename BoardT::ColorStateT ColorStateT;
 
@@ -1281,16 +1512,21 @@ namespace Chess {
       const ColorT OtherColor = OtherColorT<Color>::value;
 
       // Generate (legal) moves
-      const LegalMovesT legalMoves = MoveGen::genLegalMoves<BoardT, Color>(board);
+      const LegalMovesT legalMoves = MoveGen::genLegalMoves<BoardT, Color, /*GenCheckMasks*/!StatsT::NodesOnly>(board);
 
       const ColorPieceBbsT& yourPieceBbs = legalMoves.pieceBbs.colorPieceBbs[(size_t)OtherColor];
 
       const ColorStateT& yourState = board.state[(size_t)OtherColor];
-      const BitBoardT allYourPromoPiecesBb = getAllPromoPiecesBb<BoardT>(yourPieceBbs);
-      const ColorPieceMapT& yourPieceMap = genColorPieceMap(yourState, allYourPromoPiecesBb);
-      
       const BitBoardT allYourPiecesBb = yourPieceBbs.bbs[AllPieceTypes];
 
+      // The piece map is only used to find the captured piece, so don't bother building it if there are no captures.
+      // Nothing reads it otherwise, so it's fine to leave it uninitialised.
+      ColorPieceMapT yourPieceMap;
+      if((getAllMovesBb(legalMoves) & allYourPiecesBb) != BbNone) {
+	const BitBoardT allYourPromoPiecesBb = getAllPromoPiecesBb<BoardT>(yourPieceBbs);
+	yourPieceMap = genColorPieceMap(yourState, allYourPromoPiecesBb);
+      }
+
       // Is this an illegal pos - note this should never happen(tm) - but we will notice quickly
       if(legalMoves.isIllegalPos) {
 	static bool done = false;
@@ -1382,13 +1618,18 @@ namespace Chess {
     //   typedef MyPosHandlerT<typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
     //   typedef MyPosHandlerT<typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
     //
+    //   typedef MakeUnmakeTag MoveModeT; // optional - the default is CopyMakeTag
+    //
     //   static void handlePos(const MyStateT state, const BoardT& board, MoveInfoT moveInfo) { ... }
     //
     // };
 
-    template <typename StateT, typename PosHandlerT, typename BoardT, ColorT Color>
+    //
+    // With StatsT = NodesOnlyStatsT the check flags in MoveInfoT are not calculated.
+
+    template <typename StateT, typename PosHandlerT, typename BoardT, ColorT Color, typename StatsT = AllStatsT>
     inline void makeAllLegalMoves(StateT state, const BoardT& board) {
-      handleAllLegalMoves<StateT, PosTag, PosHandlerT, BoardT, Color>(state, board);
+      handleAllLegalMoves<StateT, PosTag, PosHandlerT, BoardT, Color, StatsT>(state, board);
     }
     
     //
@@ -1410,9 +1651,67 @@ namespace Chess {
     //
     // };
 
+    //
+    // With StatsT = NodesOnlyStatsT all stats other than nodes are passed as zero.
+
+    inline int countLegalPromoPieceMoves(const typename MoveGen::LegalMovesImplType<BasicBoardT>::LegalMovesT& legalMoves) {
+      // No promo pieces
+      return 0;
+    }
+
+    inline int countLegalPromoPieceMoves(const typename MoveGen::LegalMovesImplType<FullBoardT>::LegalMovesT& legalMoves) {
+      // Inactive promo indexes have no moves
+      int nodes = 0;
+      for(int promoIndex = 0; promoIndex < NPawns; promoIndex++) {
+	nodes += Bits::count(legalMoves.promoPieceMoves[promoIndex]);
+      }
+      return nodes;
+    }
+
+    // Just count the legal moves - no move making, no piece map and no check masks
     template <typename StateT, typename CountHandlerT, typename BoardT, ColorT Color>
+    inline void countAllLegalMoveNodes(StateT state, const BoardT& board) {
+      typedef typename MoveGen::LegalMovesImplType<BoardT>::LegalMovesT LegalMovesT;
+
+      const LegalMovesT legalMoves = MoveGen::genLegalMoves<BoardT, Color, /*GenCheckMasks*/false>(board);
+
+      // Is this an illegal pos - note this should never happen(tm)
+      if(legalMoves.isIllegalPos) {
+	return;
+      }
+
+      // Non-king moves are all empty if nChecks >= 2
+      const MoveGen::PawnPushesAndCapturesT& pawnMoves = legalMoves.pawnMoves;
+
+      // Pawn non-promo moves
+      int nodes = Bits::count(pawnMoves.pushesOneBb & ~LastRankBbT<Color>::LastRankBb) + Bits::count(pawnMoves.pushesTwoBb)
+	+ Bits::count(pawnMoves.capturesLeftBb & ~LastRankBbT<Color>::LastRankBb) + Bits::count(pawnMoves.capturesRightBb & ~LastRankBbT<Color>::LastRankBb)
+	+ (int)(pawnMoves.epCaptures.epLeftCaptureBb != BbNone) + (int)(pawnMoves.epCaptures.epRightCaptureBb != BbNone);
+
+      // Pawn promos - four promo pieces per move
+      nodes += 4 * (Bits::count(pawnMoves.pushesOneBb & LastRankBbT<Color>::LastRankBb) + Bits::count(pawnMoves.capturesLeftBb & LastRankBbT<Color>::LastRankBb) + Bits::count(pawnMoves.capturesRightBb & LastRankBbT<Color>::LastRankBb));
+
+      // Pieces including the king
+      for(PieceT piece = Knight1; piece < NPieces; piece = (PieceT)(piece+1)) {
+	nodes += Bits::count(legalMoves.pieceMoves[piece]);
+      }
+
+      // Promo pieces
+      nodes += countLegalPromoPieceMoves(legalMoves);
+
+      // Castling
+      nodes += Bits::count((BitBoardT)legalMoves.canCastleFlags);
+
+      CountHandlerT::handleCount(state, nodes, /*captures*/0, /*eps*/0, /*castles*/0, /*promos*/0, /*checks*/0, /*discoverychecks*/0, /*doublechecks*/0, /*checkmates*/0);
+    }
+
+    template <typename StateT, typename CountHandlerT, typename BoardT, ColorT Color, typename StatsT = AllStatsT>
     inline void countAllLegalMoves(StateT state, const BoardT& board) {
-      handleAllLegalMoves<StateT, CountTag, CountHandlerT, BoardT, Color>(state, board);
+      if(StatsT::NodesOnly) {
+	countAllLegalMoveNodes<StateT, CountHandlerT, BoardT, Color>(state, board);
+      } else {
+	handleAllLegalMoves<StateT, CountTag, CountHandlerT, BoardT, Color, StatsT>(state, board);
+      }
     }
     
   } // namespace MakeMove
@@ -5,6 +5,24 @@
 #include "bits.hpp"
 #include "board.hpp"
 #include "pawn-move.hpp"
+#include "magic-bbs.hpp"
+#include "slider-fill.hpp"
+
+// Slider attack backend - chosen at build time, e.g. make clean && make SLIDERS=PEXT
+#define SLIDERS_MAGIC 1
+#define SLIDERS_PEXT 2
+#define SLIDERS_TABLELESS 3
+
+#ifndef SLIDERS
+#define SLIDERS SLIDERS_MAGIC
+#endif
+
+#if SLIDERS == SLIDERS_PEXT
+#ifndef __BMI2__
+#error "SLIDERS=PEXT needs BMI2 - build with -march=native on a BMI2 machine or add -mbmi2"
+#endif
+#include <immintrin.h>
+#endif
 
 namespace Chess {
 
@@ -36,6 +54,9 @@ namespace Chess {
       typedef FullColorPieceBbsImplT ColorPieceBbsT;
     };
 
+    // BasicBbsBoardT is a BasicBoardT as far as move generation is concerned
+    template <> struct ColorPieceBbsImplType<BasicBbsBoardT> : ColorPieceBbsImplType<BasicBoardT> {};
+
     // Aggregated piece bitboards for both colors.
     template <typename BoardT>
     struct PieceBbsImplT {
@@ -48,6 +69,8 @@ namespace Chess {
     struct PieceBbsImplType {
       typedef PieceBbsImplT<BoardT> PieceBbsT;
     };
+
+    template <> struct PieceBbsImplType<BasicBbsBoardT> : PieceBbsImplType<BasicBoardT> {};
     
     struct BasicPieceAttackBbsImplT {
       // Pawn attacks (and moves) - single bit board for all pawns for each move type.
@@ -78,6 +101,8 @@ namespace Chess {
       typedef FullPieceAttackBbsImplT PieceAttackBbsT;
     };
 
+    template <> struct PieceAttackBbsImplType<BasicBbsBoardT> : PieceAttackBbsImplType<BasicBoardT> {};
+
     struct SquareAttackerBbsT {
       // Attacks on a particular square for each piece type (of a particular color).
       BitBoardT pieceAttackerBbs[NPieceTypes];
@@ -110,6 +135,8 @@ namespace Chess {
       typedef FullPiecePinMaskBbsImplT PiecePinMaskBbsT;
     };
 
+    template <> struct PiecePinMaskBbsImplType<BasicBbsBoardT> : PiecePinMaskBbsImplType<BasicBoardT> {};
+
     struct DirectCheckMasksT {
       // Pawn (direct) check squares
       BitBoardT pawnChecksBb;
@@ -222,6 +249,8 @@ namespace Chess {
     template <> struct LegalMovesImplType<FullBoardT> {
       typedef FullLegalMovesImplT<FullBoardT> LegalMovesT;
     };
+
+    template <> struct LegalMovesImplType<BasicBbsBoardT> : LegalMovesImplType<BasicBoardT> {};
     
 #include <boost/preprocessor/iteration/local.hpp>
     const u8 QueensideCastleSpaceBits = 0x07;
@@ -527,9 +556,19 @@ namespace Chess {
     template <> inline BitBoardT bishopUniRay<Black, Left>(SquareT square) { return BishopUniRays[Right][square]; }
     
     //
-    // Rays - used to generate Magic Bitboard tables
+    // Rays - used to generate Magic Bitboard tables, and directly by the table-less slider backend
+    // The InvalidSquare entries are BbNone.
+    // Rays and the slider tables below are generated at build time as const data by src/tools/gen-slider-tables.cpp
+    //
+    extern const BitBoardT Rays[8][64+1];
+
+    //
+    // BetweenBb[a][b] - the squares strictly between a and b if they share a rank, file or diagonal, else BbNone
+    // LineBb[a][b] - the whole rank, file or diagonal through a and b, else BbNone
+    // Only valid squares - no InvalidSquare entries.
     //
-    extern BitBoardT Rays[8][64];
+    extern const BitBoardT BetweenBb[64][64];
+    extern const BitBoardT LineBb[64][64];
 
     //
     // Magic Bitboards for Rook and Bishop attacks
@@ -575,139 +614,116 @@ namespace Chess {
       0x0, // InvalidSquare
     };
 
-    const BitBoardT RookMagicBbMultipliers[64+1] = {
-      0xa8002c000108020ull, 0x6c00049b0002001ull, 0x100200010090040ull, 0x2480041000800801ull, 0x280028004000800ull,
-      0x900410008040022ull, 0x280020001001080ull, 0x2880002041000080ull, 0xa000800080400034ull, 0x4808020004000ull,
-      0x2290802004801000ull, 0x411000d00100020ull, 0x402800800040080ull, 0xb000401004208ull, 0x2409000100040200ull,
-      0x1002100004082ull, 0x22878001e24000ull, 0x1090810021004010ull, 0x801030040200012ull, 0x500808008001000ull,
-      0xa08018014000880ull, 0x8000808004000200ull, 0x201008080010200ull, 0x801020000441091ull, 0x800080204005ull,
-      0x1040200040100048ull, 0x120200402082ull, 0xd14880480100080ull, 0x12040280080080ull, 0x100040080020080ull,
-      0x9020010080800200ull, 0x813241200148449ull, 0x491604001800080ull, 0x100401000402001ull, 0x4820010021001040ull,
-      0x400402202000812ull, 0x209009005000802ull, 0x810800601800400ull, 0x4301083214000150ull, 0x204026458e001401ull,
-      0x40204000808000ull, 0x8001008040010020ull, 0x8410820820420010ull, 0x1003001000090020ull, 0x804040008008080ull,
-      0x12000810020004ull, 0x1000100200040208ull, 0x430000a044020001ull, 0x280009023410300ull, 0xe0100040002240ull,
-      0x200100401700ull, 0x2244100408008080ull, 0x8000400801980ull, 0x2000810040200ull, 0x8010100228810400ull,
-      0x2000009044210200ull, 0x4080008040102101ull, 0x40002080411d01ull, 0x2005524060000901ull, 0x502001008400422ull,
-      0x489a000810200402ull, 0x1004400080a13ull, 0x4000011008020084ull, 0x26002114058042ull,
-      0x0, // InvalidSquare
+    // RookMagicBbMultipliers, BishopMagicBbMultipliers, RookMagicBbIndexBits, BishopMagicBbIndexBits and table sizes
+    //   are generated by src/tools/find-magics.cpp
+
+    //
+    // Slider attack backends - each provides static bishopAttacks() and rookAttacks() with the same signature.
+    // Only the selected backend's tables are generated - see SLIDERS above.
+    //
+
+    // Packed per-square magic - everything a lookup needs is in one half cache line.
+    // Tables are variable size - each square's attacks pointer points into one shared table.
+    struct alignas(32) MagicBbT {
+      BitBoardT mask;
+      BitBoardT multiplier;
+      const BitBoardT* attacks;
+      u32 shift;
     };
 
-    const BitBoardT BishopMagicBbMultipliers[64+1] = {
-      0x89a1121896040240ull, 0x2004844802002010ull, 0x2068080051921000ull, 0x62880a0220200808ull, 0x4042004000000ull,
-      0x100822020200011ull, 0xc00444222012000aull, 0x28808801216001ull, 0x400492088408100ull, 0x201c401040c0084ull,
-      0x840800910a0010ull, 0x82080240060ull, 0x2000840504006000ull, 0x30010c4108405004ull, 0x1008005410080802ull,
-      0x8144042209100900ull, 0x208081020014400ull, 0x4800201208ca00ull, 0xf18140408012008ull, 0x1004002802102001ull,
-      0x841000820080811ull, 0x40200200a42008ull, 0x800054042000ull, 0x88010400410c9000ull, 0x520040470104290ull,
-      0x1004040051500081ull, 0x2002081833080021ull, 0x400c00c010142ull, 0x941408200c002000ull, 0x658810000806011ull,
-      0x188071040440a00ull, 0x4800404002011c00ull, 0x104442040404200ull, 0x511080202091021ull, 0x4022401120400ull,
-      0x80c0040400080120ull, 0x8040010040820802ull, 0x480810700020090ull, 0x102008e00040242ull, 0x809005202050100ull,
-      0x8002024220104080ull, 0x431008804142000ull, 0x19001802081400ull, 0x200014208040080ull, 0x3308082008200100ull,
-      0x41010500040c020ull, 0x4012020c04210308ull, 0x208220a202004080ull, 0x111040120082000ull, 0x6803040141280a00ull,
-      0x2101004202410000ull, 0x8200000041108022ull, 0x21082088000ull, 0x2410204010040ull, 0x40100400809000ull,
-      0x822088220820214ull, 0x40808090012004ull, 0x910224040218c9ull, 0x402814422015008ull, 0x90014004842410ull,
-      0x1000042304105ull, 0x10008830412a00ull, 0x2520081090008908ull, 0x40102000a0a60140ull,
-      0x0, // InvalidSquare
+    extern const MagicBbT RookMagicBbs[64+1];
+    extern const MagicBbT BishopMagicBbs[64+1];
+    extern const BitBoardT RookMagicBbTable[RookMagicBbTableSize];
+    extern const BitBoardT BishopMagicBbTable[BishopMagicBbTableSize];
+
+    inline BitBoardT magicBbAttacks(const MagicBbT& magicBb, const BitBoardT allPiecesBb) {
+      return magicBb.attacks[((allPiecesBb & magicBb.mask) * magicBb.multiplier) >> magicBb.shift];
+    }
+
+    struct MagicSliderAttacksT {
+      // Magic BB bishop attacks
+      static inline BitBoardT bishopAttacks(const SquareT square, const BitBoardT allPiecesBb) {
+	return magicBbAttacks(BishopMagicBbs[square], allPiecesBb);
+      }
+
+      // Magic BB rook attacks
+      static inline BitBoardT rookAttacks(const SquareT square, const BitBoardT allPiecesBb) {
+	return magicBbAttacks(RookMagicBbs[square], allPiecesBb);
+      }
     };
-    
-    const u8 RookMagicBbIndexBits[64+1] = {
-      12, 11, 11, 11, 11, 11, 11, 12,
-      11, 10, 10, 10, 10, 10, 10, 11,
-      11, 10, 10, 10, 10, 10, 10, 11,
-      11, 10, 10, 10, 10, 10, 10, 11,
-      11, 10, 10, 10, 10, 10, 10, 11,
-      11, 10, 10, 10, 10, 10, 10, 11,
-      11, 10, 10, 10, 10, 10, 10, 11,
-      12, 11, 11, 11, 11, 11, 11, 12,
-      0 // InvalidSquare
+
+#if SLIDERS == SLIDERS_PEXT
+    // PEXT tables are packed - each square's attacks are at a per-square offset and indexed by the PEXT of the blockers.
+    // Sum of 2^RookMagicBbIndexBits and 2^BishopMagicBbIndexBits, plus one entry for InvalidSquare
+    const size_t RookPextBbTableSize = 102400 + 1;
+    const size_t BishopPextBbTableSize = 5248 + 1;
+
+    extern const u32 RookPextBbOffsets[64+1];
+    extern const BitBoardT RookPextBbTable[RookPextBbTableSize];
+    extern const u32 BishopPextBbOffsets[64+1];
+    extern const BitBoardT BishopPextBbTable[BishopPextBbTableSize];
+
+    struct PextSliderAttacksT {
+      // PEXT bishop attacks
+      static inline BitBoardT bishopAttacks(const SquareT square, const BitBoardT allPiecesBb) {
+	return BishopPextBbTable[BishopPextBbOffsets[square] + _pext_u64(allPiecesBb, BishopBlockers[square])];
+      }
+
+      // PEXT rook attacks
+      static inline BitBoardT rookAttacks(const SquareT square, const BitBoardT allPiecesBb) {
+	return RookPextBbTable[RookPextBbOffsets[square] + _pext_u64(allPiecesBb, RookBlockers[square])];
+      }
     };
 
-    const u8 BishopMagicBbIndexBits[64+1] = {
-      6, 5, 5, 5, 5, 5, 5, 6,
-      5, 5, 5, 5, 5, 5, 5, 5,
-      5, 5, 7, 7, 7, 7, 5, 5,
-      5, 5, 7, 9, 9, 7, 5, 5,
-      5, 5, 7, 9, 9, 7, 5, 5,
-      5, 5, 7, 7, 7, 7, 5, 5,
-      5, 5, 5, 5, 5, 5, 5, 5,
-      6, 5, 5, 5, 5, 5, 5, 6,
-      0 // InvalidSquare
+    typedef PextSliderAttacksT SliderAttacksT;
+#elif SLIDERS == SLIDERS_TABLELESS
+    // Obstruction difference - needs only Rays (4KB) so there are no slider tables to build or to pollute the cache.
+    // The line through the square is split into an upper ray (towards H8) and a lower ray (towards A1).
+    // The nearest lower blocker is the most significant lower blocker bit; subtracting it from the upper blockers
+    //   borrows through to the nearest upper blocker, so the xor flags everything from the lower to the upper blocker.
+    struct TablelessSliderAttacksT {
+      template <DirT UpperDir, DirT LowerDir>
+      static inline BitBoardT lineAttacks(const SquareT square, const BitBoardT allPiecesBb) {
+	const BitBoardT upperRayBb = Rays[UpperDir][square];
+	const BitBoardT lowerRayBb = Rays[LowerDir][square];
+	const BitBoardT upperBlockersBb = upperRayBb & allPiecesBb;
+	const BitBoardT lowerBlockersBb = lowerRayBb & allPiecesBb;
+	// The | 1 handles no lower blockers - and msb of the lower blocker is at worst bit 0 anyway
+	const BitBoardT lowerBlockerMsbBb = 0x8000000000000000ULL >> __builtin_clzll(lowerBlockersBb | 1);
+	return (upperRayBb | lowerRayBb) & (upperBlockersBb ^ (upperBlockersBb - lowerBlockerMsbBb));
+      }
+
+      static inline BitBoardT bishopAttacks(const SquareT square, const BitBoardT allPiecesBb) {
+	return lineAttacks<NE, SW>(square, allPiecesBb) | lineAttacks<NW, SE>(square, allPiecesBb);
+      }
+
+      static inline BitBoardT rookAttacks(const SquareT square, const BitBoardT allPiecesBb) {
+	return lineAttacks<N, S>(square, allPiecesBb) | lineAttacks<E, W>(square, allPiecesBb);
+      }
     };
-  
-    extern BitBoardT RookMagicBbTable[64+1][4096];
-    extern BitBoardT BishopMagicBbTable[64+1][1024];
 
-    // Magic BB bishop attacks
+    typedef TablelessSliderAttacksT SliderAttacksT;
+#else
+    typedef MagicSliderAttacksT SliderAttacksT;
+#endif
+
     inline BitBoardT bishopAttacks(const SquareT square, const BitBoardT allPiecesBb) {
-      const BitBoardT blockers = allPiecesBb & BishopBlockers[square];
-      const auto magicBbKey = (blockers * BishopMagicBbMultipliers[square]) >> (64 - BishopMagicBbIndexBits[square]);
-      return BishopMagicBbTable[square][magicBbKey];
+      return SliderAttacksT::bishopAttacks(square, allPiecesBb);
     }
 
-    // Magic BB rook attacks
     inline BitBoardT rookAttacks(const SquareT square, const BitBoardT allPiecesBb) {
-      const BitBoardT blockers = allPiecesBb & RookBlockers[square];
-      const auto magicBbKey = (blockers * RookMagicBbMultipliers[square]) >> (64 - RookMagicBbIndexBits[square]);
-      return RookMagicBbTable[square][magicBbKey];
+      return SliderAttacksT::rookAttacks(square, allPiecesBb);
     }
 
-    // I would prefer template specialisation but couldn't get it to work
-    inline BitBoardT getCheckingPieceAttacksBb(const SquareT checkingPieceSq, const ColorPieceMapT& yourPieceMap, const BasicPieceAttackBbsImplT& yourAttackBbs, const BitBoardT allMyKingAttackersBb, const BitBoardT allYourPromoPiecesBb) {
-      const PieceT checkingPiece = yourPieceMap.board[checkingPieceSq].piece;
-      return yourAttackBbs.pieceAttackBbs[checkingPiece];
-    }
-    
-    // I would prefer template specialisation but couldn't get it to work
-    inline BitBoardT getCheckingPieceAttacksBb(const SquareT checkingPieceSq, const ColorPieceMapT& yourPieceMap, const FullPieceAttackBbsImplT& yourAttackBbs, const BitBoardT allMyKingAttackersBb, const BitBoardT allYourPromoPiecesBb) {
-	const BitBoardT promoPieceAttackerBb = allMyKingAttackersBb & allYourPromoPiecesBb;
-	if(promoPieceAttackerBb != BbNone) {
-	  const int checkingPromoIndex = yourPieceMap.board[checkingPieceSq].promoIndex;
-	  return yourAttackBbs.promoPieceAttackBbs[checkingPromoIndex];
-	} else {
-	  // Can't be a pawn cos that is a contact check so must be a (non-pawn) piece
-	  const PieceT checkingPiece = yourPieceMap.board[checkingPieceSq].piece;
-	  return yourAttackBbs.pieceAttackBbs[checkingPiece];
-	}
-    }
-    
     // Generate a legal move mask for non-king moves - only valid for single check - we must capture or block the checking piece.
     template <typename BoardT, ColorT Color>
-    inline BitBoardT genLegalMoveMaskBbForSingleCheck(const BoardT& board, const BitBoardT allMyKingAttackersBb, const SquareT myKingSq, const BitBoardT allPiecesBb, const BitBoardT allYourPromoPiecesBb, const typename PieceAttackBbsImplType<BoardT>::PieceAttackBbsT& yourAttackBbs) {
-      typedef typename BoardT::ColorStateT ColorStateT;
+    inline BitBoardT genLegalMoveMaskBbForSingleCheck(const BitBoardT allMyKingAttackersBb, const SquareT myKingSq) {
+      // There can be only one piece delivering check in this path (nChecks == 1).
+      // We can always evade check by capturing it, or for a distant slider check by blocking on a square in between.
+      // Contact and knight checks have nothing in between.
+      const SquareT checkingPieceSq = Bits::lsb(allMyKingAttackersBb);
       
-      // We can always evade check by capturing the (one single) checking piece
-      BitBoardT legalMoveMaskBb = allMyKingAttackersBb;
-      
-      // There can be only one piece delivering check in this path (nChecks == 1)
-      // If it is a contact check (including knight check) then only a capture (or king move) will evade check.
-      if(((KingAttacks[myKingSq] | KnightAttacks[myKingSq]) & allMyKingAttackersBb) == BbNone) {
-	// Distant check by a slider - we can also block the check.
-	// So here we want to generate all (open) squares between your checking piece and the king, which block the check.
-	// Work backwards from the king:
-	//   Compute the check-blocking squares as the intersection of my king's slider 'view' and the checking piece's attack squares.
-	//   Note for queens we need to restrict to the slider direction otherwise we get bogus 'blocking' squares in the other queen direction.
-	
-	const ColorT OtherColor = OtherColorT<Color>::value;
-	
-	const ColorStateT& yourState = board.state[(size_t)OtherColor];
-	const ColorPieceMapT& yourPieceMap = genColorPieceMap(yourState, allYourPromoPiecesBb);
-	
-	const SquareT checkingPieceSq = Bits::lsb(allMyKingAttackersBb);
-	//BitBoardT checkingPieceAttacksBb = BbNone;
-
-	const BitBoardT checkingPieceAttacksBb = getCheckingPieceAttacksBb(checkingPieceSq, yourPieceMap, yourAttackBbs, allMyKingAttackersBb, allYourPromoPiecesBb);
-	
-	if((allMyKingAttackersBb & BishopRays[myKingSq]) != BbNone) {
-	  // Diagonal slider distance check
-	  const BitBoardT diagAttacksFromMyKingBb = bishopAttacks(myKingSq, allPiecesBb);
-	  legalMoveMaskBb |= diagAttacksFromMyKingBb & checkingPieceAttacksBb & BishopRays[checkingPieceSq];
-	} else {
-	  // Orthogonal slider distance check
-	  const BitBoardT orthogAttacksFromMyKingBb = rookAttacks(myKingSq, allPiecesBb);
-	  legalMoveMaskBb |= orthogAttacksFromMyKingBb & checkingPieceAttacksBb & RookRays[checkingPieceSq];
-	}	
-      }
-      
-      return legalMoveMaskBb;
+      return allMyKingAttackersBb | BetweenBb[myKingSq][checkingPieceSq];
     }
 
     template <SliderDirectionT SliderDirection>
@@ -737,6 +753,42 @@ namespace Chess {
       return mySliderPinnedPiecesBb;
     }
 
+    // What a king sees along its slider rays - see genKingRayBbs()
+    struct KingRayBbsT {
+      // Sliders giving check
+      BitBoardT sliderCheckersBb;
+      // Blocker pieces that are alone between the king and a slider - pinned pieces for my king, discovery pieces for your king
+      BitBoardT diagBlockersBb;
+      BitBoardT orthogBlockersBb;
+    };
+
+    inline BitBoardT genKingRayBlockersBb(BitBoardT& sliderCheckersBb, const SquareT kingSq, const BitBoardT snipersBb, const BitBoardT allPiecesBb, const BitBoardT blockersBb) {
+      BitBoardT kingRayBlockersBb = BbNone;
+      for(BitBoardT bb = snipersBb; bb;) {
+	const SquareT sniperSq = Bits::popLsb(bb);
+	const BitBoardT betweenBb = BetweenBb[kingSq][sniperSq] & allPiecesBb;
+	if(betweenBb == BbNone) {
+	  sliderCheckersBb |= bbForSquare(sniperSq);
+	} else if((betweenBb & (betweenBb - 1)) == BbNone) {
+	  kingRayBlockersBb |= betweenBb & blockersBb;
+	}
+	// Two or more pieces in between - nothing to see here
+      }
+      return kingRayBlockersBb;
+    }
+
+    // One pass over the sliders that would attack the king on an empty board - the 'snipers'.
+    // The occupied squares between the king and each sniper tell us everything:
+    //   - none means the sniper is giving check
+    //   - exactly one, of the blocker color, means a pinned piece (or a discovery piece when the sliders are mine and the king is yours)
+    // This replaces a handful of slider attack lookups per king with a walk over (usually very few) snipers.
+    inline KingRayBbsT genKingRayBbs(const SquareT kingSq, const BitBoardT allPiecesBb, const BitBoardT blockersBb, const BitBoardT diagSlidersBb, const BitBoardT orthogSlidersBb) {
+      KingRayBbsT kingRayBbs = {};
+      kingRayBbs.diagBlockersBb = genKingRayBlockersBb(kingRayBbs.sliderCheckersBb, kingSq, BishopRays[kingSq] & diagSlidersBb, allPiecesBb, blockersBb);
+      kingRayBbs.orthogBlockersBb = genKingRayBlockersBb(kingRayBbs.sliderCheckersBb, kingSq, RookRays[kingSq] & orthogSlidersBb, allPiecesBb, blockersBb);
+      return kingRayBbs;
+    }
+
     //
     // Pawn move rules are color-specific.
     //
@@ -887,6 +939,34 @@ namespace Chess {
       return attacks;
     }
 
+    // Set-wise knight attacks for all knights at once.
+    inline BitBoardT genKnightsAttacksBb(const BitBoardT knightsBb) {
+      const BitBoardT east1Bb = (knightsBb << 1) & ~FileA;
+      const BitBoardT east2Bb = (knightsBb << 2) & ~(FileA | FileB);
+      const BitBoardT west1Bb = (knightsBb >> 1) & ~FileH;
+      const BitBoardT west2Bb = (knightsBb >> 2) & ~(FileG | FileH);
+      const BitBoardT horiz1Bb = east1Bb | west1Bb;
+      const BitBoardT horiz2Bb = east2Bb | west2Bb;
+      return (horiz1Bb << 16) | (horiz1Bb >> 16) | (horiz2Bb << 8) | (horiz2Bb >> 8);
+    }
+
+    // Generate the union of all attacks of one color, including promo pieces.
+    // This is all we need of your attacks for king move and castling legality, so there's no per-piece work -
+    //   sliders are done set-wise by the vectorised slider fill.
+    template <typename BoardT, ColorT Color>
+    inline BitBoardT genAllAttacksBb(const typename ColorPieceBbsImplType<BoardT>::ColorPieceBbsT& colorPieceBbs, const BitBoardT allPiecesBb) {
+      const BitBoardT pawnsBb = colorPieceBbs.bbs[Pawn];
+      const BitBoardT pawnsAttacksBb = PawnMove::from2ToBb<Color, PawnMove::AttackLeft>(pawnsBb) | PawnMove::from2ToBb<Color, PawnMove::AttackRight>(pawnsBb);
+
+      const BitBoardT knightsAttacksBb = genKnightsAttacksBb(colorPieceBbs.bbs[Knight]);
+
+      const BitBoardT kingAttacksBb = KingAttacks[Bits::lsb(colorPieceBbs.bbs[King])];
+
+      const BitBoardT slidersAttacksBb = SliderFill::allSliderAttacksBb(colorPieceBbs.sliderBbs[Diagonal], colorPieceBbs.sliderBbs[Orthogonal], allPiecesBb);
+
+      return pawnsAttacksBb | knightsAttacksBb | kingAttacksBb | slidersAttacksBb;
+    }
+
     // Generate attackers/defenders of a particular square.
     // Useful for check detection.
     template <typename BoardT, ColorT Color>
@@ -953,32 +1033,32 @@ namespace Chess {
     }
     
     // Bishops
-    //   - diagonally pinned bishops can only move along the king's bishop rays
+    //   - diagonally pinned bishops can only move along the pin line
     //   - orthogonally pinned bishops cannot move
     template <> inline BitBoardT genPinnedMoveMask<Bishop>(const SquareT bishopSq, const SquareT myKingSq, const BitBoardT myDiagPinnedPiecesBb, const BitBoardT myOrthogPinnedPiecesBb) {
       const BitBoardT bishopBb = bbForSquare(bishopSq);
-      const BitBoardT diagPinnedMoveMask = (bishopBb & myDiagPinnedPiecesBb) == BbNone ? BbAll : BishopRays[myKingSq];
+      const BitBoardT diagPinnedMoveMask = (bishopBb & myDiagPinnedPiecesBb) == BbNone ? BbAll : LineBb[myKingSq][bishopSq];
       const BitBoardT orthogPinnedMoveMaskBb = (bishopBb & myOrthogPinnedPiecesBb) == BbNone ? BbAll : BbNone;
       return diagPinnedMoveMask & orthogPinnedMoveMaskBb;
     }
     
     // Rooks
     //   - diagonally pinned rooks cannot move
-    //   - orthogonally pinned rooks can only move along the king's rook rays
+    //   - orthogonally pinned rooks can only move along the pin line
     template <> inline BitBoardT genPinnedMoveMask<Rook>(const SquareT rookSq, const SquareT myKingSq, const BitBoardT myDiagPinnedPiecesBb, const BitBoardT myOrthogPinnedPiecesBb) {
       const BitBoardT rookBb = bbForSquare(rookSq);
       const BitBoardT diagPinnedMoveMask = (rookBb & myDiagPinnedPiecesBb) == BbNone ? BbAll : BbNone;
-      const BitBoardT orthogPinnedMoveMaskBb = (rookBb & myOrthogPinnedPiecesBb) == BbNone ? BbAll : RookRays[myKingSq];
+      const BitBoardT orthogPinnedMoveMaskBb = (rookBb & myOrthogPinnedPiecesBb) == BbNone ? BbAll : LineBb[myKingSq][rookSq];
       return diagPinnedMoveMask & orthogPinnedMoveMaskBb;
     }
     
     // Queen Moves
-    //   - diagonally pinned queens can only move along the king's bishop rays
-    //   - orthogonally pinned queens can only move along the king's rook rays
+    //   - diagonally pinned queens can only move along the (diagonal) pin line
+    //   - orthogonally pinned queens can only move along the (orthogonal) pin line
     template <> inline BitBoardT genPinnedMoveMask<Queen>(const SquareT queenSq, const SquareT myKingSq, const BitBoardT myDiagPinnedPiecesBb, const BitBoardT myOrthogPinnedPiecesBb) {
       const BitBoardT queenBb = bbForSquare(queenSq);
-      const BitBoardT diagPinnedMoveMask = (queenBb & myDiagPinnedPiecesBb) == BbNone ? BbAll : BishopRays[myKingSq] & ~RookRays[queenSq];
-      const BitBoardT orthogPinnedMoveMaskBb = (queenBb & myOrthogPinnedPiecesBb) == BbNone ? BbAll : RookRays[myKingSq] & ~BishopRays[queenSq];
+      const BitBoardT diagPinnedMoveMask = (queenBb & myDiagPinnedPiecesBb) == BbNone ? BbAll : LineBb[myKingSq][queenSq] & BishopRays[myKingSq];
+      const BitBoardT orthogPinnedMoveMaskBb = (queenBb & myOrthogPinnedPiecesBb) == BbNone ? BbAll : LineBb[myKingSq][queenSq] & RookRays[myKingSq];
       return diagPinnedMoveMask & orthogPinnedMoveMaskBb;
     }
     
@@ -1120,29 +1200,16 @@ namespace Chess {
     }
     
     template <typename BoardT, ColorT Color>
-    inline typename PiecePinMaskBbsImplType<BoardT>::PiecePinMaskBbsT genPinMaskBbs(const BoardT& board, const typename PieceBbsImplType<BoardT>::PieceBbsT& pieceBbs) {
+    inline typename PiecePinMaskBbsImplType<BoardT>::PiecePinMaskBbsT genPinMaskBbs(const BoardT& board, const KingRayBbsT& myKingRayBbs) {
       typedef typename BoardT::ColorStateT ColorStateT;
       
-      typedef typename ColorPieceBbsImplType<BoardT>::ColorPieceBbsT ColorPieceBbsT;
       typedef typename PiecePinMaskBbsImplType<BoardT>::PiecePinMaskBbsT PiecePinMaskBbsT;
       
-      const ColorT OtherColor = OtherColorT<Color>::value;
-      
       const ColorStateT& myState = board.state[(size_t)Color];
       
-      const ColorPieceBbsT& myPieceBbs = pieceBbs.colorPieceBbs[(size_t)Color];
-      const ColorPieceBbsT& yourPieceBbs = pieceBbs.colorPieceBbs[(size_t)OtherColor];
-      
-      const BitBoardT allMyPiecesBb = myPieceBbs.bbs[AllPieceTypes];
-      const BitBoardT allYourPiecesBb = yourPieceBbs.bbs[AllPieceTypes];
-      
-      const BitBoardT allPiecesBb = allMyPiecesBb | allYourPiecesBb;
-
-      const SquareT myKingSq = myState.basic.pieceSquares[TheKing];
-
-      // Find my pinned pieces - used to mask out invalid moves due to discovered check on my king
-      const BitBoardT myDiagPinnedPiecesBb = genPinnedPiecesBb<BoardT, Diagonal>(myKingSq, allPiecesBb, allMyPiecesBb, yourPieceBbs);
-      const BitBoardT myOrthogPinnedPiecesBb = genPinnedPiecesBb<BoardT, Orthogonal>(myKingSq, allPiecesBb, allMyPiecesBb, yourPieceBbs);
+      // My pinned pieces - used to mask out invalid moves due to discovered check on my king
+      const BitBoardT myDiagPinnedPiecesBb = myKingRayBbs.diagBlockersBb;
+      const BitBoardT myOrthogPinnedPiecesBb = myKingRayBbs.orthogBlockersBb;
       
       // Generate pinned piece move masks for each piece
       PiecePinMaskBbsT pinMaskBbs = {};
@@ -1157,7 +1224,7 @@ namespace Chess {
     }
 
     template <typename BoardT, ColorT Color>
-    inline DiscoveredCheckMasksT genDiscoveryMasks(const BoardT& board, const typename PieceBbsImplType<BoardT>::PieceBbsT& pieceBbs, const BitBoardT legalEpCaptureLeftBb, const BitBoardT legalEpCaptureRightBb, const CastlingRightsT canCastleFlags) {
+    inline DiscoveredCheckMasksT genDiscoveryMasks(const BoardT& board, const typename PieceBbsImplType<BoardT>::PieceBbsT& pieceBbs, const KingRayBbsT& yourKingRayBbs, const BitBoardT legalEpCaptureLeftBb, const BitBoardT legalEpCaptureRightBb, const CastlingRightsT canCastleFlags) {
       typedef typename BoardT::ColorStateT ColorStateT;
 
       typedef typename ColorPieceBbsImplType<BoardT>::ColorPieceBbsT ColorPieceBbsT;
@@ -1175,9 +1242,9 @@ namespace Chess {
 
       const SquareT yourKingSq = yourState.basic.pieceSquares[TheKing];
 
-      // Find my pieces that are blocking check - used for discovered check detection.
-      const BitBoardT myDiagDiscoveryPiecesBb = genPinnedPiecesBb<BoardT, Diagonal>(yourKingSq, allPiecesBb, allMyPiecesBb, myPieceBbs);
-      const BitBoardT myOrthogDiscoveryPiecesBb = genPinnedPiecesBb<BoardT, Orthogonal>(yourKingSq, allPiecesBb, allMyPiecesBb, myPieceBbs);
+      // My pieces that are blocking check - used for discovered check detection.
+      const BitBoardT myDiagDiscoveryPiecesBb = yourKingRayBbs.diagBlockersBb;
+      const BitBoardT myOrthogDiscoveryPiecesBb = yourKingRayBbs.orthogBlockersBb;
 
       // Pawn push discovery pieces are all (pawn) diag discovery pieces AND all (pawn) orthog discovery pieces on the rank of the king.
       const BitBoardT pawnPushDiscoveryMasksBb = myDiagDiscoveryPiecesBb | (myOrthogDiscoveryPiecesBb & RankBbs[rankOf(yourKingSq)]);
@@ -1255,7 +1322,7 @@ namespace Chess {
     }
 
     template <typename BoardT, ColorT Color>
-    inline EpPawnCapturesT genLegalPawnEpCaptures(const BoardT& board, const typename ColorPieceBbsImplType<BoardT>::ColorPieceBbsT& yourPieceBbs, const typename PieceAttackBbsImplType<BoardT>::PieceAttackBbsT myAttackBbs, const SquareT epSquare, const BitBoardT allYourPiecesBb, const BitBoardT allPiecesBb, const BitBoardT nonPinnedPawnsLeftBb, const BitBoardT nonPinnedPawnsRightBb, const BitBoardT legalMoveMaskBb) {
+    inline EpPawnCapturesT genLegalPawnEpCaptures(const BoardT& board, const typename ColorPieceBbsImplType<BoardT>::ColorPieceBbsT& yourPieceBbs, const SquareT epSquare, const BitBoardT allYourPiecesBb, const BitBoardT allPiecesBb, const BitBoardT nonPinnedPawnsLeftBb, const BitBoardT nonPinnedPawnsRightBb, const BitBoardT legalMoveMaskBb) {
       typedef typename BoardT::ColorStateT ColorStateT;
       
       const BitBoardT epSquareBb = bbForSquare(epSquare);
@@ -1322,7 +1389,7 @@ namespace Chess {
       const BitBoardT legalPawnsRightBb = nonPinnedPawnsRightBb & legalMoveMaskBb & allYourPiecesBb;
 
       // Pawn en-passant captures
-      const EpPawnCapturesT legalEpPawnCaptures = (epSquare == InvalidSquare) ? EpPawnCapturesT() : genLegalPawnEpCaptures<BoardT, Color>(board, yourPieceBbs, myAttackBbs, epSquare, allYourPiecesBb, allPiecesBb, nonPinnedPawnsLeftBb, nonPinnedPawnsRightBb, legalMoveMaskBb);
+      const EpPawnCapturesT legalEpPawnCaptures = (epSquare == InvalidSquare) ? EpPawnCapturesT() : genLegalPawnEpCaptures<BoardT, Color>(board, yourPieceBbs, epSquare, allYourPiecesBb, allPiecesBb, nonPinnedPawnsLeftBb, nonPinnedPawnsRightBb, legalMoveMaskBb);
 
       return PawnPushesAndCapturesT(legalPawnsPushOneBb, legalPawnsPushTwoBb, legalPawnsLeftBb, legalPawnsRightBb, legalEpPawnCaptures);
     }
@@ -1360,7 +1427,7 @@ namespace Chess {
       
       const BitBoardT allPiecesBb = allMyPiecesBb | allYourPiecesBb;
 
-      legalMoves.pawnMoves = genLegalPawnMoves<BoardT, Color>(board, yourPieceBbs, myAttackBbs, yourState.basic.epSquare, allYourPiecesBb, allPiecesBb, legalMoveMaskBb, pinMaskBbs);
+      legalMoves.pawnMoves = genLegalPawnMoves<BoardT, Color>(board, yourPieceBbs, myAttackBbs, getEpSquare(yourState.basic), allYourPiecesBb, allPiecesBb, legalMoveMaskBb, pinMaskBbs);
       
       legalMoves.pieceMoves[Knight1] = genLegalPieceMoves<BoardT>(Knight1, myAttackBbs, legalMoveMaskBb, pinMaskBbs, allMyPiecesBb);
       legalMoves.pieceMoves[Knight2] = genLegalPieceMoves<BoardT>(Knight2, myAttackBbs, legalMoveMaskBb, pinMaskBbs, allMyPiecesBb);
@@ -1377,8 +1444,125 @@ namespace Chess {
       genPromoPieceMoves(legalMoves, myState, myAttackBbs, legalMoveMaskBb, pinMaskBbs, allMyPiecesBb);
     }
 
+    //
+    // Check evasion - single check only.
+    //
+    // The only legal non-king moves are captures of the checking piece and blocks on the squares in between.
+    // Pinned pieces can never evade check - they can't leave their pin ray, and the checker and the blocking squares are
+    //   on a different ray from the king - so only my unpinned pieces get any moves.
+    // Rather than generating all the attacks of all of my pieces and masking them, we go the other way - at most 7 target
+    //   squares, and for each we look up my unpinned knights and sliders that attack it.
+    // The pawn evasions and unpinned pieces are shared with BoardUtils::hasLegalEvasions().
+    //
+
+    // My pieces that aren't pinned to my king, i.e. that might evade a check
+    inline BitBoardT genUnpinnedPiecesBb(const BitBoardT allMyPiecesBb, const KingRayBbsT& myKingRayBbs) {
+      return allMyPiecesBb & ~(myKingRayBbs.diagBlockersBb | myKingRayBbs.orthogBlockersBb);
+    }
+
+    // Pawn moves that evade a single check - captures of the checker, including en-passant, and blocks
+    template <typename BoardT, ColorT Color>
+    inline PawnPushesAndCapturesT genLegalPawnEvasions(const BoardT& board, const typename ColorPieceBbsImplType<BoardT>::ColorPieceBbsT& yourPieceBbs, const BitBoardT myUnpinnedPawnsBb, const BitBoardT allMyKingAttackersBb, const BitBoardT legalMoveMaskBb, const BitBoardT allPiecesBb) {
+      const ColorT OtherColor = OtherColorT<Color>::value;
+
+      const BitBoardT pawnsPushOneBb = PawnMove::from2ToBb<Color, PawnMove::PushOne>(myUnpinnedPawnsBb) & ~allPiecesBb;
+      const BitBoardT pawnsPushTwoBb = pawnsPushTwo<Color>(pawnsPushOneBb, allPiecesBb);
+      
+      const BitBoardT pawnsLeftAttacksBb = PawnMove::from2ToBb<Color, PawnMove::AttackLeft>(myUnpinnedPawnsBb);
+      const BitBoardT pawnsRightAttacksBb = PawnMove::from2ToBb<Color, PawnMove::AttackRight>(myUnpinnedPawnsBb);
+
+      // The checking pawn might be capturable en-passant
+      const SquareT epSquare = getEpSquare(board.state[(size_t)OtherColor].basic);
+      const EpPawnCapturesT legalEpPawnCaptures = (epSquare == InvalidSquare) ? EpPawnCapturesT() : genLegalPawnEpCaptures<BoardT, Color>(board, yourPieceBbs, epSquare, yourPieceBbs.bbs[AllPieceTypes], allPiecesBb, pawnsLeftAttacksBb, pawnsRightAttacksBb, legalMoveMaskBb);
+      
+      return PawnPushesAndCapturesT(pawnsPushOneBb & legalMoveMaskBb, pawnsPushTwoBb & legalMoveMaskBb, pawnsLeftAttacksBb & allMyKingAttackersBb, pawnsRightAttacksBb & allMyKingAttackersBb, legalEpPawnCaptures);
+    }
+
+    // Add a move to the square for my (unpinned, non-pawn, non-king) piece on attackerSq
+    inline void addEvasionPieceMove(BasicLegalMovesImplT<BasicBoardT>& legalMoves, const BasicColorStateImplT& myState, const SquareT attackerSq, const BitBoardT toBb) {
+      for(int piece = Knight1; piece <= TheQueen; piece++) {
+	if(myState.basic.pieceSquares[piece] == attackerSq) {
+	  legalMoves.pieceMoves[piece] |= toBb;
+	  return;
+	}
+      }
+    }
+
+    inline void addEvasionPieceMove(FullLegalMovesImplT<FullBoardT>& legalMoves, const FullColorStateImplT& myState, const SquareT attackerSq, const BitBoardT toBb) {
+      for(int piece = Knight1; piece <= TheQueen; piece++) {
+	if(myState.basic.pieceSquares[piece] == attackerSq) {
+	  legalMoves.pieceMoves[piece] |= toBb;
+	  return;
+	}
+      }
+
+      // Must be a promo piece then
+      // Ugh the bit stuff operates on BitBoardT type
+      BitBoardT activePromos = (BitBoardT)myState.promos.activePromos;
+      while(activePromos) {
+	const int promoIndex = Bits::popLsb(activePromos);
+	if(squareOf(myState.promos.promos[promoIndex]) == attackerSq) {
+	  legalMoves.promoPieceMoves[promoIndex] |= toBb;
+	  return;
+	}
+      }
+    }
+
+    template <typename BoardT, ColorT Color>
+    inline void genLegalEvasionMoves(typename LegalMovesImplType<BoardT>::LegalMovesT& legalMoves, const BoardT& board, const typename PieceBbsImplType<BoardT>::PieceBbsT& pieceBbs, const BitBoardT allMyKingAttackersBb, const SquareT myKingSq, const KingRayBbsT& myKingRayBbs) {
+      typedef typename BoardT::ColorStateT ColorStateT;
+      
+      typedef typename ColorPieceBbsImplType<BoardT>::ColorPieceBbsT ColorPieceBbsT;
+      
+      const ColorT OtherColor = OtherColorT<Color>::value;
+
+      const ColorStateT& myState = board.state[(size_t)Color];
+      
+      const ColorPieceBbsT& myPieceBbs = pieceBbs.colorPieceBbs[(size_t)Color];
+      const ColorPieceBbsT& yourPieceBbs = pieceBbs.colorPieceBbs[(size_t)OtherColor];
+      
+      const BitBoardT allMyPiecesBb = myPieceBbs.bbs[AllPieceTypes];
+      const BitBoardT allYourPiecesBb = yourPieceBbs.bbs[AllPieceTypes];
+      
+      const BitBoardT allPiecesBb = allMyPiecesBb | allYourPiecesBb;
+
+      // Capture the checker or block in between
+      const BitBoardT legalMoveMaskBb = genLegalMoveMaskBbForSingleCheck<BoardT, Color>(allMyKingAttackersBb, myKingSq);
+
+      const BitBoardT myUnpinnedPiecesBb = genUnpinnedPiecesBb(allMyPiecesBb, myKingRayBbs);
+
+      // Pawns - set-wise as usual, but only the unpinned ones
+      legalMoves.pawnMoves = genLegalPawnEvasions<BoardT, Color>(board, yourPieceBbs, myPieceBbs.bbs[Pawn] & myUnpinnedPiecesBb, allMyKingAttackersBb, legalMoveMaskBb, allPiecesBb);
+
+      // Pieces - my unpinned knights and sliders that attack each target square
+      const BitBoardT myKnightsBb = myPieceBbs.bbs[Knight] & myUnpinnedPiecesBb;
+      const BitBoardT myDiagSlidersBb = myPieceBbs.sliderBbs[Diagonal] & myUnpinnedPiecesBb;
+      const BitBoardT myOrthogSlidersBb = myPieceBbs.sliderBbs[Orthogonal] & myUnpinnedPiecesBb;
+
+      if((myKnightsBb | myDiagSlidersBb | myOrthogSlidersBb) == BbNone) {
+	return;
+      }
+      
+      for(BitBoardT targetsBb = legalMoveMaskBb; targetsBb;) {
+	const SquareT targetSq = Bits::popLsb(targetsBb);
+	const BitBoardT targetBb = bbForSquare(targetSq);
+
+	BitBoardT attackersBb = KnightAttacks[targetSq] & myKnightsBb;
+	if(myDiagSlidersBb != BbNone) {
+	  attackersBb |= bishopAttacks(targetSq, allPiecesBb) & myDiagSlidersBb;
+	}
+	if(myOrthogSlidersBb != BbNone) {
+	  attackersBb |= rookAttacks(targetSq, allPiecesBb) & myOrthogSlidersBb;
+	}
+
+	while(attackersBb) {
+	  addEvasionPieceMove(legalMoves, myState, Bits::popLsb(attackersBb), targetBb);
+	}
+      }
+    }
+
     template <typename BoardT, ColorT Color>
-    inline CastlingRightsT genLegalCastlingFlags(const BoardT& board, const typename PieceAttackBbsImplType<BoardT>::PieceAttackBbsT& yourAttackBbs, const BitBoardT allPiecesBb) {
+    inline CastlingRightsT genLegalCastlingFlags(const BoardT& board, const BitBoardT yourAttacksBb, const BitBoardT allPiecesBb) {
       typedef typename BoardT::ColorStateT ColorStateT;
       
       const ColorStateT& myState = board.state[(size_t)Color];
@@ -1388,11 +1572,11 @@ namespace Chess {
       CastlingRightsT castlingRights = castlingRightsWithSpace<Color>(myState.basic.castlingRights, allPiecesBb);
       if(castlingRights) {
 	
-	if((castlingRights & CanCastleQueenside) && (yourAttackBbs.allAttacksBb & CastlingTraitsT<Color, CanCastleQueenside>::CastlingThruCheckBbMask) == BbNone) {
+	if((castlingRights & CanCastleQueenside) && (yourAttacksBb & CastlingTraitsT<Color, CanCastleQueenside>::CastlingThruCheckBbMask) == BbNone) {
 	  canCastleFlags = (CastlingRightsT)(canCastleFlags | CanCastleQueenside);
 	}
 	
-	if((castlingRights & CanCastleKingside) && (yourAttackBbs.allAttacksBb & CastlingTraitsT<Color, CanCastleKingside>::CastlingThruCheckBbMask) == BbNone) {
+	if((castlingRights & CanCastleKingside) && (yourAttacksBb & CastlingTraitsT<Color, CanCastleKingside>::CastlingThruCheckBbMask) == BbNone) {
 	  canCastleFlags = (CastlingRightsT)(canCastleFlags | CanCastleKingside);
 	}	
       }
@@ -1401,7 +1585,7 @@ namespace Chess {
     }
     
     template <typename BoardT, ColorT Color>
-    inline BitBoardT genLegalKingMoves(const BoardT& board, const typename PieceBbsImplType<BoardT>::PieceBbsT& pieceBbs, const typename PieceAttackBbsImplType<BoardT>::PieceAttackBbsT& yourAttackBbs, const BitBoardT allMyKingAttackersBb) {
+    inline BitBoardT genLegalKingMoves(const BoardT& board, const typename PieceBbsImplType<BoardT>::PieceBbsT& pieceBbs, const BitBoardT yourAttacksBb, const BitBoardT allMyKingAttackersBb) {
       typedef typename BoardT::ColorStateT ColorStateT;
 
       typedef typename ColorPieceBbsImplType<BoardT>::ColorPieceBbsT ColorPieceBbsT;
@@ -1434,7 +1618,7 @@ namespace Chess {
       }
 
       const SquareT kingSq = myState.basic.pieceSquares[TheKing];
-      const BitBoardT legalKingMovesBb = KingAttacks[kingSq] & ~yourAttackBbs.allAttacksBb & ~illegalKingSquaresBb;
+      const BitBoardT legalKingMovesBb = KingAttacks[kingSq] & ~yourAttacksBb & ~illegalKingSquaresBb;
 
       return legalKingMovesBb & ~allMyPiecesBb;
     }
@@ -1519,6 +1703,37 @@ namespace Chess {
       return pieceBbs;
     }
 
+    // BasicBbsBoardT keeps its piece bitboards up to date - only the slider aggregates are left to do
+    inline BasicColorPieceBbsImplT genColorPieceBbs(const ColorBbsImplT& colorBbs) {
+      BasicColorPieceBbsImplT pieceBbs = {};
+
+      for(int pieceType = 0; pieceType < NPieceTypes; pieceType++) {
+	pieceBbs.bbs[pieceType] = colorBbs.bbs[pieceType];
+      }
+
+      pieceBbs.sliderBbs[Diagonal] = pieceBbs.bbs[Bishop] | pieceBbs.bbs[Queen];
+      pieceBbs.sliderBbs[Orthogonal] = pieceBbs.bbs[Rook] | pieceBbs.bbs[Queen];
+
+      return pieceBbs;
+    }
+
+    inline typename PieceBbsImplType<BasicBbsBoardT>::PieceBbsT genBbsBoardPieceBbs(const BasicBbsBoardT& board) {
+      typename PieceBbsImplType<BasicBbsBoardT>::PieceBbsT pieceBbs;
+
+      pieceBbs.colorPieceBbs[(size_t)White] = genColorPieceBbs(board.colorBbs[(size_t)White]);
+      pieceBbs.colorPieceBbs[(size_t)Black] = genColorPieceBbs(board.colorBbs[(size_t)Black]);
+
+      return pieceBbs;
+    }
+
+    template <> inline typename PieceBbsImplType<BasicBbsBoardT>::PieceBbsT genPieceBbs<BasicBbsBoardT, White>(const BasicBbsBoardT& board) {
+      return genBbsBoardPieceBbs(board);
+    }
+
+    template <> inline typename PieceBbsImplType<BasicBbsBoardT>::PieceBbsT genPieceBbs<BasicBbsBoardT, Black>(const BasicBbsBoardT& board) {
+      return genBbsBoardPieceBbs(board);
+    }
+
     inline BitBoardT getAllPromoPiecesBb(const BasicColorPieceBbsImplT& colorPieceBbs) {
       return BbNone; // no promo pieces
     }
@@ -1527,7 +1742,8 @@ namespace Chess {
       return colorPieceBbs.allPromoPiecesBb;
     }
     
-    template <typename BoardT, ColorT Color>
+    // GenCheckMasks = false skips the direct-check and discovered-check masks for when we don't care about checks, e.g. node counting.
+    template <typename BoardT, ColorT Color, bool GenCheckMasks = true>
     inline typename LegalMovesImplType<BoardT>::LegalMovesT genLegalMoves(const BoardT& board) {
       typedef typename BoardT::ColorStateT ColorStateT;
       
@@ -1554,43 +1770,58 @@ namespace Chess {
       const BitBoardT allYourPiecesBb = yourPieceBbs.bbs[AllPieceTypes];
       const BitBoardT allPiecesBb = allMyPiecesBb | allYourPiecesBb;
       
-      // Generate moves - TODO this and yourAttackBbs are interesting side-channel data to return in LegalMovesT
-      const PieceAttackBbsT myAttackBbs = genPieceAttackBbs<BoardT, Color>(myState, allPiecesBb);
-
-      // Is your king in check? If so this is an illegal position
-      legalMoves.isIllegalPos = (myAttackBbs.allAttacksBb & yourPieceBbs.bbs[King]) != 0;
-
       const SquareT myKingSq = myState.basic.pieceSquares[TheKing];
+      // One pass along my king's rays gives both slider checks and my pinned pieces
+      const KingRayBbsT myKingRayBbs = genKingRayBbs(myKingSq, allPiecesBb, allMyPiecesBb, yourPieceBbs.sliderBbs[Diagonal], yourPieceBbs.sliderBbs[Orthogonal]);
       // I have made several attempts to pass nChecks as a parameter into genLegalMoves since we can get it from MoveInfoT but somehow it doesn't help      
-      const SquareAttackerBbsT myKingAttackerBbs = genSquareAttackerBbs<BoardT, OtherColor>(myKingSq, yourPieceBbs, allPiecesBb);
-      const BitBoardT allMyKingAttackersBb = myKingAttackerBbs.pieceAttackerBbs[AllPieceTypes];
+      const BitBoardT allMyKingAttackersBb =
+	(PawnAttackerBbs[(size_t)OtherColor][myKingSq] & yourPieceBbs.bbs[Pawn]) |
+	(KnightAttacks[myKingSq] & yourPieceBbs.bbs[Knight]) |
+	(KingAttacks[myKingSq] & yourPieceBbs.bbs[King]) |
+	myKingRayBbs.sliderCheckersBb;
       const int nChecks = Bits::count(allMyKingAttackersBb);
       legalMoves.nChecks = nChecks;
       
       // Needed for castling and for king moves so evaluate this here.
-      const PieceAttackBbsT yourAttackBbs = genPieceAttackBbs<BoardT, OtherColor>(yourState, allPiecesBb);
+      const BitBoardT yourAttacksBb = genAllAttacksBb<BoardT, OtherColor>(yourPieceBbs, allPiecesBb);
 
-      // Double check can only be evaded by moving the king so only bother with other pieces if nChecks < 2
-      if(nChecks < 2) {
+      if(nChecks == 0) {
+	// Generate moves - TODO this and yourAttackBbs are interesting side-channel data to return in LegalMovesT
+	const PieceAttackBbsT myAttackBbs = genPieceAttackBbs<BoardT, Color>(myState, allPiecesBb);
+
+	// Is your king in check? If so this is an illegal position
+	legalMoves.isIllegalPos = (myAttackBbs.allAttacksBb & yourPieceBbs.bbs[King]) != 0;
 
-	// If we're in check then the only legal moves are capture or blocking of the checking piece.
-	const BitBoardT allYourPromoPiecesBb = getAllPromoPiecesBb(yourPieceBbs);
-	const BitBoardT legalMoveMaskBb = nChecks == 0 ? BbAll : genLegalMoveMaskBbForSingleCheck<BoardT, Color>(board, allMyKingAttackersBb, myKingSq, allPiecesBb, allYourPromoPiecesBb, yourAttackBbs);
-	  
 	// Calculate pinned piece move restrictions.
-	const PiecePinMaskBbsT pinMaskBbs = genPinMaskBbs<BoardT, Color>(board, pieceBbs);
+	const PiecePinMaskBbsT pinMaskBbs = genPinMaskBbs<BoardT, Color>(board, myKingRayBbs);
 
 	// Filter legal non-king moves
-	genLegalNonKingMoves<BoardT, Color>(legalMoves, board, pieceBbs, myAttackBbs, legalMoveMaskBb, pinMaskBbs);
+	genLegalNonKingMoves<BoardT, Color>(legalMoves, board, pieceBbs, myAttackBbs, BbAll, pinMaskBbs);
 
 	// Castling
-	legalMoves.canCastleFlags = genLegalCastlingFlags<BoardT, Color>(board, yourAttackBbs, allPiecesBb);
+	legalMoves.canCastleFlags = genLegalCastlingFlags<BoardT, Color>(board, yourAttacksBb, allPiecesBb);
+	
+      } else {
+	// In check we don't need my attacks at all, so just look at the attackers of your king for the illegal position check
+	const SquareT yourKingSq = yourState.basic.pieceSquares[TheKing];
+	legalMoves.isIllegalPos = genSquareAttackerBbs<BoardT, Color>(yourKingSq, myPieceBbs, allPiecesBb).pieceAttackerBbs[AllPieceTypes] != BbNone;
+
+	// No castling out of check
+	if(nChecks == 1) {
+	  genLegalEvasionMoves<BoardT, Color>(legalMoves, board, pieceBbs, allMyKingAttackersBb, myKingSq, myKingRayBbs);
+	}
       }
+      // Double check can only be evaded by moving the king
 
-      legalMoves.pieceMoves[TheKing] = genLegalKingMoves<BoardT, Color>(board, pieceBbs, yourAttackBbs, allMyKingAttackersBb);
+      legalMoves.pieceMoves[TheKing] = genLegalKingMoves<BoardT, Color>(board, pieceBbs, yourAttacksBb, allMyKingAttackersBb);
 
-      legalMoves.directChecks = genDirectCheckMasks<ColorStateT, Color>(yourState, allPiecesBb);
-      legalMoves.discoveredChecks = genDiscoveryMasks<BoardT, Color>(board, pieceBbs, legalMoves.pawnMoves.epCaptures.epLeftCaptureBb, legalMoves.pawnMoves.epCaptures.epRightCaptureBb, legalMoves.canCastleFlags);
+      if(GenCheckMasks) {
+	legalMoves.directChecks = genDirectCheckMasks<ColorStateT, Color>(yourState, allPiecesBb);
+	// And along your king's rays for my discovery pieces
+	const SquareT yourKingSq = yourState.basic.pieceSquares[TheKing];
+	const KingRayBbsT yourKingRayBbs = genKingRayBbs(yourKingSq, allPiecesBb, allMyPiecesBb, myPieceBbs.sliderBbs[Diagonal], myPieceBbs.sliderBbs[Orthogonal]);
+	legalMoves.discoveredChecks = genDiscoveryMasks<BoardT, Color>(board, pieceBbs, yourKingRayBbs, legalMoves.pawnMoves.epCaptures.epLeftCaptureBb, legalMoves.pawnMoves.epCaptures.epRightCaptureBb, legalMoves.canCastleFlags);
+      }
       
       return legalMoves;
     }
@@ -0,0 +1,342 @@
+#ifndef MOVE_LIST_HPP
+#define MOVE_LIST_HPP
+
+#include "types.hpp"
+#include "bits.hpp"
+#include "board.hpp"
+#include "move-gen.hpp"
+#include "pawn-move.hpp"
+
+namespace Chess {
+
+  using namespace Board;
+
+  namespace MoveList {
+
+    //
+    // Legal moves as data rather than callbacks - for search, move ordering, move parsing and the like.
+    //
+    // genLegalMoveList() unpacks the LegalMovesT bitboards from MoveGen::genLegalMoves() into a fixed-size array of
+    //   packed 16-bit moves, and makeMove() makes one of them on a copy of the board.
+    // makeAllLegalMoves() in make-move.hpp remains the fast path when every move is going to be made anyway - it knows
+    //   the moving and captured piece at the point of generation, where makeMove() has to look them up again.
+    // Limitations - makeMove() only works on FullBoardT, and it only gives the new position - it doesn't produce the
+    //   MoveInfoT or check info that the stats counters need. So the --move-list perft driver is nodes-only.
+    //
+    // Moves are packed as:
+    //
+    //   bits 0-5    from square
+    //   bits 6-11   to square - for castling this is the king's to square
+    //   bits 12-15  MoveFlagsT
+    //
+
+    typedef u16 MoveT;
+
+    // Promo flags carry the PromoPieceT in the bottom two bits
+    enum MoveFlagsT {
+      QuietFlags = 0,
+      PawnPushTwoFlags = 1,
+      KingsideCastlingFlags = 2,
+      QueensideCastlingFlags = 3,
+      CaptureFlags = 4,
+      EpCaptureFlags = 5,
+      PromoFlags = 8,
+      PromoCaptureFlags = 12,
+    };
+
+    const int MoveFromShift = 0;
+    const int MoveToShift = 6;
+    const int MoveFlagsShift = 12;
+
+    const u16 MoveSquareMask = 0x3f;
+
+    const u16 IsCaptureFlagsBit = 4;
+    const u16 IsPromoFlagsBit = 8;
+
+    inline MoveT moveOf(const SquareT from, const SquareT to, const int flags) {
+      return (MoveT) ((from << MoveFromShift) | (to << MoveToShift) | (flags << MoveFlagsShift));
+    }
+
+    inline SquareT moveFromOf(const MoveT move) {
+      return (SquareT) ((move >> MoveFromShift) & MoveSquareMask);
+    }
+
+    inline SquareT moveToOf(const MoveT move) {
+      return (SquareT) ((move >> MoveToShift) & MoveSquareMask);
+    }
+
+    inline int moveFlagsOf(const MoveT move) {
+      return move >> MoveFlagsShift;
+    }
+
+    // Includes ep and promo captures
+    inline bool isCapture(const MoveT move) {
+      return (moveFlagsOf(move) & IsCaptureFlagsBit) != 0;
+    }
+
+    inline bool isPromo(const MoveT move) {
+      return (moveFlagsOf(move) & IsPromoFlagsBit) != 0;
+    }
+
+    inline bool isCastling(const MoveT move) {
+      const int flags = moveFlagsOf(move);
+      return flags == KingsideCastlingFlags || flags == QueensideCastlingFlags;
+    }
+
+    // Only valid for promos
+    inline PromoPieceT movePromoPieceOf(const MoveT move) {
+      return (PromoPieceT) (moveFlagsOf(move) & 0x3);
+    }
+
+    // The most legal moves known in any position is 218
+    const int MaxMoves = 256;
+
+    // Lives on the stack - no heap allocation
+    struct MoveListT {
+      MoveT moves[MaxMoves];
+      int size;
+    };
+
+    inline void addMove(MoveListT& moveList, const SquareT from, const SquareT to, const int flags) {
+      moveList.moves[moveList.size++] = moveOf(from, to, flags);
+    }
+
+    // Piece (or promo piece) moves - captures are the moves onto your pieces
+    inline void addPieceMoves(MoveListT& moveList, const SquareT from, BitBoardT movesBb, const BitBoardT allYourPiecesBb) {
+      while(movesBb) {
+	const SquareT to = Bits::popLsb(movesBb);
+	addMove(moveList, from, to, ((allYourPiecesBb >> to) & 1) != 0 ? CaptureFlags : QuietFlags);
+      }
+    }
+
+    template <ColorT Color, PawnMove::DirT Dir>
+    inline void addPawnMoves(MoveListT& moveList, BitBoardT toBb, const int flags) {
+      while(toBb) {
+	const SquareT to = Bits::popLsb(toBb);
+	addMove(moveList, (SquareT)PawnMove::to2FromSq<Color, Dir>(to), to, flags);
+      }
+    }
+
+    // One move per promo piece - queen first
+    template <ColorT Color, PawnMove::DirT Dir>
+    inline void addPawnPromoMoves(MoveListT& moveList, BitBoardT toBb, const int flags) {
+      while(toBb) {
+	const SquareT to = Bits::popLsb(toBb);
+	const SquareT from = (SquareT)PawnMove::to2FromSq<Color, Dir>(to);
+	addMove(moveList, from, to, flags | PromoQueen);
+	addMove(moveList, from, to, flags | PromoKnight);
+	addMove(moveList, from, to, flags | PromoRook);
+	addMove(moveList, from, to, flags | PromoBishop);
+      }
+    }
+
+    template <ColorT Color>
+    inline void addPromoPieceMoves(MoveListT& moveList, const BasicBoardT& board, const typename MoveGen::LegalMovesImplType<BasicBoardT>::LegalMovesT& legalMoves, const BitBoardT allYourPiecesBb) {
+      // No promo pieces
+    }
+
+    template <ColorT Color>
+    inline void addPromoPieceMoves(MoveListT& moveList, const FullBoardT& board, const typename MoveGen::LegalMovesImplType<FullBoardT>::LegalMovesT& legalMoves, const BitBoardT allYourPiecesBb) {
+      const FullColorStateImplT& myState = board.state[(size_t)Color];
+
+      // Ugh the bit stuff operates on BitBoardT type
+      BitBoardT activePromos = (BitBoardT)myState.promos.activePromos;
+      while(activePromos) {
+	const int promoIndex = Bits::popLsb(activePromos);
+	addPieceMoves(moveList, squareOf(myState.promos.promos[promoIndex]), legalMoves.promoPieceMoves[promoIndex], allYourPiecesBb);
+      }
+    }
+
+    // Generate all legal moves into moveList - which is empty for an illegal position, i.e. if your king is in check.
+    template <typename BoardT, ColorT Color>
+    inline void genLegalMoveList(const BoardT& board, MoveListT& moveList) {
+      typedef typename MoveGen::LegalMovesImplType<BoardT>::LegalMovesT LegalMovesT;
+
+      const ColorT OtherColor = OtherColorT<Color>::value;
+
+      moveList.size = 0;
+
+      const LegalMovesT legalMoves = MoveGen::genLegalMoves<BoardT, Color, /*GenCheckMasks*/false>(board);
+
+      if(legalMoves.isIllegalPos) {
+	return;
+      }
+
+      const BitBoardT allYourPiecesBb = legalMoves.pieceBbs.colorPieceBbs[(size_t)OtherColor].bbs[AllPieceTypes];
+
+      // Double check can only be evaded by moving the king
+      if(legalMoves.nChecks < 2) {
+	const MoveGen::PawnPushesAndCapturesT& pawnMoves = legalMoves.pawnMoves;
+	const BitBoardT LastRankBb = LastRankBbT<Color>::LastRankBb;
+
+	// Pawns
+	addPawnMoves<Color, PawnMove::PushOne>(moveList, pawnMoves.pushesOneBb & ~LastRankBb, QuietFlags);
+	addPawnMoves<Color, PawnMove::PushTwo>(moveList, pawnMoves.pushesTwoBb, PawnPushTwoFlags);
+	addPawnMoves<Color, PawnMove::AttackLeft>(moveList, pawnMoves.capturesLeftBb & ~LastRankBb, CaptureFlags);
+	addPawnMoves<Color, PawnMove::AttackRight>(moveList, pawnMoves.capturesRightBb & ~LastRankBb, CaptureFlags);
+	addPawnMoves<Color, PawnMove::AttackLeft>(moveList, pawnMoves.epCaptures.epLeftCaptureBb, EpCaptureFlags);
+	addPawnMoves<Color, PawnMove::AttackRight>(moveList, pawnMoves.epCaptures.epRightCaptureBb, EpCaptureFlags);
+
+	// Pawn promos
+	addPawnPromoMoves<Color, PawnMove::PushOne>(moveList, pawnMoves.pushesOneBb & LastRankBb, PromoFlags);
+	addPawnPromoMoves<Color, PawnMove::AttackLeft>(moveList, pawnMoves.capturesLeftBb & LastRankBb, PromoCaptureFlags);
+	addPawnPromoMoves<Color, PawnMove::AttackRight>(moveList, pawnMoves.capturesRightBb & LastRankBb, PromoCaptureFlags);
+
+	// Knights, bishops, rooks and queen
+	for(int piece = Knight1; piece <= TheQueen; piece++) {
+	  addPieceMoves(moveList, board.state[(size_t)Color].basic.pieceSquares[piece], legalMoves.pieceMoves[piece], allYourPiecesBb);
+	}
+
+	// Promo pieces
+	addPromoPieceMoves<Color>(moveList, board, legalMoves, allYourPiecesBb);
+
+	// Castling - by the king's from and to squares
+	if((legalMoves.canCastleFlags & CanCastleKingside)) {
+	  typedef MoveGen::CastlingTraitsT<Color, CanCastleKingside> CastlingTraitsT;
+	  addMove(moveList, CastlingTraitsT::KingFrom, CastlingTraitsT::KingTo, KingsideCastlingFlags);
+	}
+	if((legalMoves.canCastleFlags & CanCastleQueenside)) {
+	  typedef MoveGen::CastlingTraitsT<Color, CanCastleQueenside> CastlingTraitsT;
+	  addMove(moveList, CastlingTraitsT::KingFrom, CastlingTraitsT::KingTo, QueensideCastlingFlags);
+	}
+      }
+
+      // King
+      addPieceMoves(moveList, board.state[(size_t)Color].basic.pieceSquares[TheKing], legalMoves.pieceMoves[TheKing], allYourPiecesBb);
+    }
+
+    // Non-pawn piece on the square, or NoPiece
+    inline PieceT pieceOnSquare(const NonPromosColorStateImplT& basicState, const SquareT square) {
+      for(int piece = Knight1; piece <= TheKing; piece++) {
+	if(basicState.pieceSquares[piece] == square) {
+	  return (PieceT)piece;
+	}
+      }
+      return NoPiece;
+    }
+
+    // Index of the promo piece on the square, or -1
+    inline int promoIndexOnSquare(const FullColorStateImplT& colorState, const SquareT square) {
+      BitBoardT activePromos = (BitBoardT)colorState.promos.activePromos;
+      while(activePromos) {
+	const int promoIndex = Bits::popLsb(activePromos);
+	if(squareOf(colorState.promos.promos[promoIndex]) == square) {
+	  return promoIndex;
+	}
+      }
+      return -1;
+    }
+
+    //
+    // Make a move from genLegalMoveList() on a copy of the board.
+    //
+    // This is on FullBoardT only - the 16-bit move says nothing about whether the resulting position has promo pieces,
+    //   so we can't pick a board representation up front like makeAllLegalMoves() does.
+    // Use copyBoard() to get a FullBoardT from a BasicBoardT.
+    // The captured piece is looked up into a ColorPieceMapT that is only filled in at the 'to' square, which is all the
+    //   capture primitives read - don't hand it to anything else.
+    //
+    template <ColorT Color>
+    inline FullBoardT makeMove(const FullBoardT& oldBoard, const MoveT move) {
+      const ColorT OtherColor = OtherColorT<Color>::value;
+
+      const SquareT from = moveFromOf(move);
+      const SquareT to = moveToOf(move);
+      const int flags = moveFlagsOf(move);
+
+      FullBoardT board = oldBoard;
+
+      const FullColorStateImplT& myState = oldBoard.state[(size_t)Color];
+      const FullColorStateImplT& yourState = oldBoard.state[(size_t)OtherColor];
+
+      switch(flags) {
+      case PawnPushTwoFlags:
+	makePushPawn<FullBoardT, Color, /*IsPawnPushTwo*/true>(board, from, to);
+	return board;
+
+      case KingsideCastlingFlags: {
+	typedef MoveGen::CastlingTraitsT<Color, CanCastleKingside> CastlingTraitsT;
+	makePushPiece<FullBoardT, Color>(board, TheKing, CastlingTraitsT::KingFrom, CastlingTraitsT::KingTo);
+	makePushPiece<FullBoardT, Color>(board, CastlingTraitsT::TheRook, CastlingTraitsT::RookFrom, CastlingTraitsT::RookTo);
+	return board;
+      }
+
+      case QueensideCastlingFlags: {
+	typedef MoveGen::CastlingTraitsT<Color, CanCastleQueenside> CastlingTraitsT;
+	makePushPiece<FullBoardT, Color>(board, TheKing, CastlingTraitsT::KingFrom, CastlingTraitsT::KingTo);
+	makePushPiece<FullBoardT, Color>(board, CastlingTraitsT::TheRook, CastlingTraitsT::RookFrom, CastlingTraitsT::RookTo);
+	return board;
+      }
+
+      case EpCaptureFlags:
+	makeCaptureEp<FullBoardT, Color>(board, from, to, (SquareT)PawnMove::to2FromSq<Color, PawnMove::PushOne>(to));
+	return board;
+      }
+
+      if(!isCapture(move)) {
+	if(isPromo(move)) {
+	  makePushPawnToPromo<FullBoardT, Color>(board, from, to, movePromoPieceOf(move));
+	} else if((myState.basic.pawnsBb & bbForSquare(from)) != BbNone) {
+	  makePushPawn<FullBoardT, Color>(board, from, to);
+	} else {
+	  const PieceT piece = pieceOnSquare(myState.basic, from);
+	  if(piece != NoPiece) {
+	    makePushPiece<FullBoardT, Color>(board, piece, from, to);
+	  } else {
+	    const int promoIndex = promoIndexOnSquare(myState, from);
+	    makePushPromoPiece<FullBoardT, Color>(board, promoIndex, promoPieceOf(myState.promos.promos[promoIndex]), to);
+	  }
+	}
+	return board;
+      }
+
+      // The capture primitives only look at the 'to' square of the piece map - so that's all we fill in.
+      // Pawns are NoPiece in the piece map.
+      ColorPieceMapT yourPieceMap;
+      const int yourPromoIndex = promoIndexOnSquare(yourState, to);
+      const bool isPromoCapture = yourPromoIndex != -1;
+      if(isPromoCapture) {
+	yourPieceMap.board[to].promoIndex = (u8)yourPromoIndex;
+      } else {
+	yourPieceMap.board[to].piece = pieceOnSquare(yourState.basic, to);
+      }
+
+      if(isPromo(move)) {
+	if(isPromoCapture) {
+	  makeCapturePromoPieceWithPawnToPromo<FullBoardT, Color>(board, yourPieceMap, from, to, movePromoPieceOf(move));
+	} else {
+	  makeCaptureWithPawnToPromo<FullBoardT, Color>(board, yourPieceMap, from, to, movePromoPieceOf(move));
+	}
+      } else if((myState.basic.pawnsBb & bbForSquare(from)) != BbNone) {
+	if(isPromoCapture) {
+	  makeCapturePromoPieceWithPawn<FullBoardT, Color>(board, yourPieceMap, from, to);
+	} else {
+	  makeCaptureWithPawn<FullBoardT, Color>(board, yourPieceMap, from, to);
+	}
+      } else {
+	const PieceT piece = pieceOnSquare(myState.basic, from);
+	if(piece != NoPiece) {
+	  if(isPromoCapture) {
+	    makeCapturePromoPieceWithPiece<FullBoardT, Color>(board, piece, yourPieceMap, from, to);
+	  } else {
+	    makeCaptureWithPiece<FullBoardT, Color>(board, piece, yourPieceMap, from, to);
+	  }
+	} else {
+	  const int promoIndex = promoIndexOnSquare(myState, from);
+	  const PromoPieceT promoPiece = promoPieceOf(myState.promos.promos[promoIndex]);
+	  if(isPromoCapture) {
+	    makeCapturePromoPieceWithPromoPiece<FullBoardT, Color>(board, promoIndex, promoPiece, yourPieceMap, from, to);
+	  } else {
+	    makeCaptureWithPromoPiece<FullBoardT, Color>(board, promoIndex, promoPiece, yourPieceMap, from, to);
+	  }
+	}
+      }
+
+      return board;
+    }
+
+  } // namespace MoveList
+
+} // namespace Chess
+
+#endif //ndef MOVE_LIST_HPP
@@ -1,5 +1,8 @@
 #include <cstdio>
 #include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
 
 #include "board.hpp"
 #include "board-utils.hpp"
@@ -13,6 +16,10 @@ void Perft::dumpStats(const Perft::PerftStatsT& stats) {
   printf("directonlybackrankchecks = %lu, bishops = %lu, rooks = %lu, queen-diags = %lu, queen-orthogs = %lu, knights = %lu\n", stats.directonlybackrankchecks, stats.directonlybackrankchecksbishops, stats.directonlybackrankchecksrooks, stats.directonlybackrankchecksqueendiags, stats.directonlybackrankchecksqueenorthogs, stats.directonlybackrankchecksknights);
 }
 
+void Perft::dumpNodes(const Perft::PerftStatsT& stats) {
+  printf("nodes = %lu\n", stats.nodes);
+}
+
 static void do_special_and_die(int depthToGo) {
     printf("Hallo RPJ\n");
     //auto basicBoard = Fen::parseFen("r3k2r/Pppp1ppp/1b3nbN/nPP5/BB2P3/q4N2/Pp1P2PP/R2Q1RK1 b kq - 0 1").first;
@@ -24,55 +31,96 @@ static void do_special_and_die(int depthToGo) {
     BoardUtils::printBoard<FullBoardT>(board);
     printf("\n%s\n\n", Fen::toFen<FullBoardT>(board, White).c_str());
     
-    Perft::PerftStatsT stats = Perft::perft<FullBoardT, White>(board, 1, true);
+    Perft::PerftStatsT stats = Perft::perft<Perft::AllStatsT, FullBoardT, White>(board, 1, true);
     
     printf("perft(%d) - nodes = %lu, captures = %lu, eps = %lu, castles = %lu, promos = %lu, checks = %lu, discoveries = %lu, doublechecks = %lu, checkmates = %lu\n", depthToGo, stats.nodes, stats.captures, stats.eps, stats.castles, stats.promos, stats.checks, stats.discoverychecks, stats.doublechecks, stats.checkmates);
   
     exit(1);
 }
 
+// Run-time failures, e.g. TT file I/O, where the usage message would just be noise
+static void die(const char* msg) {
+  // Keep the message after what we've already printed
+  fflush(stdout);
+  fprintf(stderr, "%s\n", msg);
+  exit(1);
+}
+
 static void usage_and_die(int argc, char* argv[], const char* msg = 0) {
   if(msg) {
     fprintf(stderr, "%s\n\n", msg);
   }
   
-  fprintf(stderr, "usage: %s <depth> [FEN] [--split] [--max-tt-depth <depth>] [--tt-size <size>] [--tt-partitions <parts>] [--make-moves] [--threads <N>]\n\n", argv[0]);
+  fprintf(stderr, "usage: %s <depth> [FEN] [--split] [--max-tt-depth <depth>] [--tt-size <size>] [--tt-partitions <parts>] [--tt-type <lru|lockless>] [--tt-mb <MB>] [--tt-file <path>] [--make-moves] [--nodes-only] [--threads <N>] [--split-depth <depth|auto>] [--steal-depth <depth>] [--journal <path> | --resume <path>] [--bbs-board] [--make-unmake] [--move-list]\n\n", argv[0]);
   fprintf(stderr, "  Default position is the starting position; also use \"-\" for starting position, e.g. %s 6 \"-\" --max-tt-depth 4\n", argv[0]);
   fprintf(stderr, "  --split provides top-level subtree statistics per top-level move - this is useful for debugging\n");
   fprintf(stderr, "  --max-tt-depth <depth> enables tableauing of results for transpositions up to <depth>\n");
   fprintf(stderr, "      Transition tables (TTs) are only used from level 3 and deeper since no shallower transpositions are possible\n");
-  fprintf(stderr, "  --tt-size <size> defines the maximum TT size for each level for each partition (default 16384)\n");
-  fprintf(stderr, "      TT entries at each level are discarded according to LRU\n");
+  fprintf(stderr, "  --tt-size <size> defines the maximum TT size for each partition (default 16384)\n");
+  fprintf(stderr, "      TT entries are discarded according to LRU\n");
   fprintf(stderr, "  --tt-partitions <parts> defines the number of partitions that the TT's are split into (default 16)\n");
   fprintf(stderr, "      Partioned TT's are required to scale multi-threading beyond 16 threads. MUST be a power of 2\n");
+  fprintf(stderr, "  --tt-type <lru|lockless> selects the TT implementation (default lru)\n");
+  fprintf(stderr, "      lru is the FEN-keyed LRU TT's sized by --tt-size and --tt-partitions\n");
+  fprintf(stderr, "      lockless is a pre-allocated lock-free TT keyed on Zobrist hash and sized by --tt-mb\n");
+  fprintf(stderr, "      Both TT types share one table across all depths\n");
+  fprintf(stderr, "  --tt-mb <MB> memory for the lockless TT - entries for smaller subtrees are replaced first (default 256)\n");
+  fprintf(stderr, "  --tt-file <path> backs the lockless TT with a memory-mapped file that persists across runs - implies --tt-type lockless\n");
+  fprintf(stderr, "      An existing file is reused if it has the same hash scheme, stats mode (--nodes-only or not) and --tt-mb, else it is reset\n");
+  fprintf(stderr, "      Entries from earlier runs are replaced first, so that a reused file keeps taking in new positions\n");
   fprintf(stderr, "  --make-moves does all move do/undo up til leaf nodes which is slower that counting one level above\n");
-  fprintf(stderr, "  --threads <N> runs N threads which distribute perft calculations from depth 2 and deeper\n");
+  fprintf(stderr, "  --nodes-only counts leaf nodes only - captures, checks, checkmates etc. are not gathered, which is faster\n");
+  fprintf(stderr, "  --threads <N> runs N threads which distribute perft calculations from the split depth and deeper\n");
+  fprintf(stderr, "  --split-depth <depth|auto> depth at which the tree is split into work items for --threads (default auto)\n");
+  fprintf(stderr, "      auto uses the shallowest depth with at least %d items per thread\n", Perft::ParaPerftAutoItemsPerThread);
+  fprintf(stderr, "  --steal-depth <depth> deepest level at which busy threads split off subtrees for idle threads (default 5)\n");
+  fprintf(stderr, "  --journal <path> records each completed --threads work item in a journal file\n");
+  fprintf(stderr, "  --resume <path> resumes an interrupted --threads run from its journal, skipping completed work items and appending to the journal\n");
+  fprintf(stderr, "  --bbs-board uses a board that carries its piece bitboards rather than regenerating them at each node\n");
+  fprintf(stderr, "      This is for benchmarking board copy cost against regeneration - it can't be combined with TTs or --threads\n");
+  fprintf(stderr, "  --make-unmake makes and unmakes each move in place on one board rather than making it on a copy of the board\n");
+  fprintf(stderr, "      This is for benchmarking against copy-make - it can't be combined with TTs, --threads or --split\n");
+  fprintf(stderr, "  --move-list generates each position's moves into a move list and then makes them one by one\n");
+  fprintf(stderr, "      This is for benchmarking against makeAllLegalMoves() - it only counts nodes so needs --nodes-only, and it can't be combined with TTs, --threads, --split, --bbs-board or --make-unmake\n");
   fprintf(stderr, "\n");
   
   exit(1);
 }
 
 
-template <typename BoardT, ColorT Color>
-static std::pair<Perft::PerftStatsT, std::vector<std::pair<u64, u64>>> runPerft(const BoardT& board, const int depthToGo, const bool doSplit, const int maxTtDepth, const int ttSize, const int nTtParts, const bool makeMoves, const int nThreads) {
+enum TtTypeT {
+  LruTt,
+  LocklessTt
+};
+
+template <typename StatsT, typename TtT, typename BoardT, ColorT Color>
+static std::pair<Perft::PerftStatsT, std::vector<std::pair<u64, u64>>> runPerft(const BoardT& board, const int depthToGo, const bool doSplit, const int maxTtDepth, TtT& tt, const bool makeMoves, const int nThreads, const int splitDepth, const int maxStealDepth, const std::string& journalFile, const bool resumeJournal) {
   Perft::PerftStatsT stats;
   std::vector<std::pair<u64, u64>> ttStats;
 
   // When --threads argument is not specified then we run inline
-  if(nThreads == 0) {
+  if(nThreads == 0 || depthToGo == 0) {
     // Single-threaded
     if(maxTtDepth != 0) {
-      auto allStats = Perft::ttPerft<BoardT, Color>(board, depthToGo, doSplit, makeMoves, maxTtDepth, ttSize, nTtParts);
+      auto allStats = Perft::ttPerft<StatsT, TtT, BoardT, Color>(board, depthToGo, doSplit, makeMoves, maxTtDepth, tt);
       stats = allStats.first;
       ttStats = allStats.second;
     } else if(doSplit) {
-      stats = Perft::splitPerft<BoardT, Color>(board, depthToGo, makeMoves);
+      stats = Perft::splitPerft<StatsT, BoardT, Color>(board, depthToGo, makeMoves);
     } else {
-      stats = Perft::perft<BoardT, Color>(board, depthToGo, makeMoves);
+      stats = Perft::perft<StatsT, BoardT, Color>(board, depthToGo, makeMoves);
     }
   } else {
     // Multi-threaded  
-    auto allStats = Perft::paraPerft<BoardT, Color>(board, doSplit, makeMoves, maxTtDepth, depthToGo, ttSize, nTtParts, nThreads);
+    std::unique_ptr<Perft::PerftJournalT> journal;
+    if(!journalFile.empty()) {
+      try {
+	journal.reset(new Perft::PerftJournalT(journalFile, StatsT::NodesOnly, resumeJournal));
+      } catch(const std::runtime_error& e) {
+	die(e.what());
+      }
+    }
+    auto allStats = Perft::paraPerft<StatsT, TtT, BoardT, Color>(board, doSplit, makeMoves, maxTtDepth, splitDepth, maxStealDepth, depthToGo, tt, nThreads, journal.get());
     stats = allStats.first;
     ttStats = allStats.second;
   }
@@ -80,6 +128,82 @@ static std::pair<Perft::PerftStatsT, std::vector<std::pair<u64, u64>>> runPerft(
   return std::make_pair(stats, ttStats);
 }
 
+template <typename StatsT, typename BoardT, ColorT Color>
+static std::pair<Perft::PerftStatsT, std::vector<std::pair<u64, u64>>> runPerft(const BoardT& board, const int depthToGo, const bool doSplit, const int maxTtDepth, const TtTypeT ttType, const int ttSize, const int nTtParts, const size_t ttMb, const std::string& ttFile, const bool makeMoves, const int nThreads, const int splitDepth, const int maxStealDepth, const std::string& journalFile, const bool resumeJournal) {
+  if(ttType == LocklessTt && !ttFile.empty()) {
+    std::unique_ptr<Perft::LocklessPerftTtT<StatsT>> tt;
+    try {
+      tt.reset(new Perft::LocklessPerftTtT<StatsT>(ttMb, ttFile));
+    } catch(const std::runtime_error& e) {
+      die(e.what());
+    }
+    printf("  %s TT file %s\n\n", tt->isLoaded() ? "warm-starting from" : "initialised new", ttFile.c_str());
+    return runPerft<StatsT, Perft::LocklessPerftTtT<StatsT>, BoardT, Color>(board, depthToGo, doSplit, maxTtDepth, *tt, makeMoves, nThreads, splitDepth, maxStealDepth, journalFile, resumeJournal);
+  } else if(ttType == LocklessTt) {
+    Perft::LocklessPerftTtT<StatsT> tt(ttMb);
+    return runPerft<StatsT, Perft::LocklessPerftTtT<StatsT>, BoardT, Color>(board, depthToGo, doSplit, maxTtDepth, tt, makeMoves, nThreads, splitDepth, maxStealDepth, journalFile, resumeJournal);
+  } else {
+    Perft::LruPerftTtT tt(ttSize, nTtParts);
+    return runPerft<StatsT, Perft::LruPerftTtT, BoardT, Color>(board, depthToGo, doSplit, maxTtDepth, tt, makeMoves, nThreads, splitDepth, maxStealDepth, journalFile, resumeJournal);
+  }
+}
+
+template <typename BoardT, ColorT Color>
+static std::pair<Perft::PerftStatsT, std::vector<std::pair<u64, u64>>> runPerft(const BoardT& board, const int depthToGo, const bool doSplit, const int maxTtDepth, const TtTypeT ttType, const int ttSize, const int nTtParts, const size_t ttMb, const std::string& ttFile, const bool makeMoves, const bool nodesOnly, const int nThreads, const int splitDepth, const int maxStealDepth, const std::string& journalFile, const bool resumeJournal) {
+  if(nodesOnly) {
+    return runPerft<Perft::NodesOnlyStatsT, BoardT, Color>(board, depthToGo, doSplit, maxTtDepth, ttType, ttSize, nTtParts, ttMb, ttFile, makeMoves, nThreads, splitDepth, maxStealDepth, journalFile, resumeJournal);
+  } else {
+    return runPerft<Perft::AllStatsT, BoardT, Color>(board, depthToGo, doSplit, maxTtDepth, ttType, ttSize, nTtParts, ttMb, ttFile, makeMoves, nThreads, splitDepth, maxStealDepth, journalFile, resumeJournal);
+  }
+}
+
+// Plain single-threaded perft only - that's all we need to compare board representations, and it saves instantiating everything twice.
+template <typename StatsT, typename BoardT, ColorT Color>
+static Perft::PerftStatsT runBbsBoardPerft(const BoardT& board, const int depthToGo, const bool doSplit, const bool makeMoves) {
+  return doSplit ?
+    Perft::splitPerft<StatsT, BoardT, Color>(board, depthToGo, makeMoves) :
+    Perft::perft<StatsT, BoardT, Color>(board, depthToGo, makeMoves);
+}
+
+template <ColorT Color>
+static std::pair<Perft::PerftStatsT, std::vector<std::pair<u64, u64>>> runBbsBoardPerft(const BasicBoardT& basicBoard, const int depthToGo, const bool doSplit, const bool makeMoves, const bool nodesOnly) {
+  const BasicBbsBoardT board = Board::copyBoard<BasicBbsBoardT, BasicBoardT>(basicBoard);
+
+  const Perft::PerftStatsT stats = nodesOnly ?
+    runBbsBoardPerft<Perft::NodesOnlyStatsT, BasicBbsBoardT, Color>(board, depthToGo, doSplit, makeMoves) :
+    runBbsBoardPerft<Perft::AllStatsT, BasicBbsBoardT, Color>(board, depthToGo, doSplit, makeMoves);
+
+  return std::make_pair(stats, std::vector<std::pair<u64, u64>>());
+}
+
+// In-place make/unmake - plain single-threaded perft only, for comparison against copy-make.
+template <typename BoardT, ColorT Color>
+static std::pair<Perft::PerftStatsT, std::vector<std::pair<u64, u64>>> runMakeUnmakePerft(const BoardT& board, const int depthToGo, const bool makeMoves, const bool nodesOnly) {
+  const Perft::PerftStatsT stats = nodesOnly ?
+    Perft::perft<Perft::NodesOnlyStatsT, BoardT, Color, Perft::MakeUnmakeTag>(board, depthToGo, makeMoves) :
+    Perft::perft<Perft::AllStatsT, BoardT, Color, Perft::MakeUnmakeTag>(board, depthToGo, makeMoves);
+
+  return std::make_pair(stats, std::vector<std::pair<u64, u64>>());
+}
+
+template <ColorT Color>
+static std::pair<Perft::PerftStatsT, std::vector<std::pair<u64, u64>>> runMakeUnmakePerft(const BasicBoardT& board, const int depthToGo, const bool makeMoves, const bool nodesOnly, const bool bbsBoard) {
+  if(bbsBoard) {
+    const BasicBbsBoardT bbsBoard = Board::copyBoard<BasicBbsBoardT, BasicBoardT>(board);
+    return runMakeUnmakePerft<BasicBbsBoardT, Color>(bbsBoard, depthToGo, makeMoves, nodesOnly);
+  } else {
+    return runMakeUnmakePerft<BasicBoardT, Color>(board, depthToGo, makeMoves, nodesOnly);
+  }
+}
+
+// Materialised move lists - plain single-threaded perft only, for comparison against the callback-style move generation.
+template <ColorT Color>
+static std::pair<Perft::PerftStatsT, std::vector<std::pair<u64, u64>>> runMoveListPerft(const BasicBoardT& board, const int depthToGo, const bool makeMoves) {
+  const Perft::PerftStatsT stats = Perft::moveListPerft<BasicBoardT, Color>(board, depthToGo, makeMoves);
+
+  return std::make_pair(stats, std::vector<std::pair<u64, u64>>());
+}
+
 int main(int argc, char* argv[]) {
   // printf("sizeof(NonPromosColorStateImplT) is %lu - NPieces is %d\n", sizeof(NonPromosColorStateImplT), NPieces);
   // printf("sizeof(BasicBoardT) is %lu\n", sizeof(BasicBoardT));
@@ -99,8 +223,21 @@ int main(int argc, char* argv[]) {
   int maxTtDepth = 0;
   int ttSize = 16384;
   int nTtParts = 16;
+  TtTypeT ttType = LruTt;
+  size_t ttMb = 256;
+  std::string ttFile;
+  bool isTtMbSet = false;
+  bool isTtTypeLruSet = false;
   bool makeMoves = false;
+  bool nodesOnly = false;
   int nThreads = 0;
+  int splitDepth = Perft::AutoSplitDepth;
+  int maxStealDepth = 5;
+  std::string journalFile;
+  bool resumeJournal = false;
+  bool bbsBoard = false;
+  bool makeUnmake = false;
+  bool moveList = false;
 
   if(depthToGo < 0) {
     usage_and_die(argc, argv, "<depth> must be >= 0");
@@ -114,9 +251,13 @@ int main(int argc, char* argv[]) {
     board = BoardUtils::startingPosition();
     colorToMove = White;
   } else {
-    auto boardAndColor = Fen::parseFen(argv[2]);
-    board = boardAndColor.first;
-    colorToMove = boardAndColor.second;
+    try {
+      auto boardAndColor = Fen::parseFen(argv[2]);
+      board = boardAndColor.first;
+      colorToMove = boardAndColor.second;
+    } catch(const std::invalid_argument& e) {
+      usage_and_die(argc, argv, e.what());
+    }
   }
 
   // Parse flags
@@ -152,8 +293,42 @@ int main(int argc, char* argv[]) {
       if(nTtParts < 1 || (nTtParts & (nTtParts-1)) != 0) {
 	usage_and_die(argc, argv, "Invalid TT partitions - must be a positive power of two.");
       }
+    } else if(arg == "--tt-type") {
+      i++;
+      if(argc <= i) {
+	usage_and_die(argc, argv, "--tt-type missing <lru|lockless> argument");
+      }
+      std::string ttTypeArg = argv[i];
+      if(ttTypeArg == "lru") {
+	ttType = LruTt;
+	isTtTypeLruSet = true;
+      } else if(ttTypeArg == "lockless") {
+	ttType = LocklessTt;
+      } else {
+	usage_and_die(argc, argv, "Invalid TT type - must be lru or lockless");
+      }
+    } else if(arg == "--tt-mb") {
+      i++;
+      if(argc <= i) {
+	usage_and_die(argc, argv, "--tt-mb missing <MB> argument");
+      }
+      long mb = atol(argv[i]);
+      if(mb < 1) {
+	usage_and_die(argc, argv, "Invalid TT MB");
+      }
+      ttMb = (size_t)mb;
+      isTtMbSet = true;
+    } else if(arg == "--tt-file") {
+      i++;
+      if(argc <= i) {
+	usage_and_die(argc, argv, "--tt-file missing <path> argument");
+      }
+      ttFile = argv[i];
+      ttType = LocklessTt;
     } else if(arg == "--make-moves") {
       makeMoves = true;
+    } else if(arg == "--nodes-only") {
+      nodesOnly = true;
     } else if(arg == "--threads") {
       i++;
       if(argc <= i) {
@@ -163,14 +338,77 @@ int main(int argc, char* argv[]) {
       if(nThreads < 1 || nThreads > 8192) {
 	usage_and_die(argc, argv, "Invalid #threads <N> - --threads 1 through --threads 8192 are valid");
       }
-      if(nThreads > 1 && depthToGo <= 2) {
-	usage_and_die(argc, argv, "Multi-threading is only valid for depth > 2");
+    } else if(arg == "--split-depth") {
+      i++;
+      if(argc <= i) {
+	usage_and_die(argc, argv, "--split-depth missing <depth|auto> argument");
+      }
+      if(std::string(argv[i]) == "auto") {
+	splitDepth = Perft::AutoSplitDepth;
+      } else {
+	splitDepth = atoi(argv[i]);
+	if(splitDepth < 1) {
+	  usage_and_die(argc, argv, "Invalid <split-depth> - must be auto or at least 1");
+	}
+      }
+    } else if(arg == "--journal" || arg == "--resume") {
+      i++;
+      if(argc <= i) {
+	usage_and_die(argc, argv, (arg + " missing <path> argument").c_str());
+      }
+      if(!journalFile.empty()) {
+	usage_and_die(argc, argv, "Only one of --journal or --resume can be given");
+      }
+      journalFile = argv[i];
+      resumeJournal = arg == "--resume";
+    } else if(arg == "--steal-depth") {
+      i++;
+      if(argc <= i) {
+	usage_and_die(argc, argv, "--steal-depth missing <depth> argument");
       }
+      maxStealDepth = atoi(argv[i]);
+      if(maxStealDepth < 1) {
+	usage_and_die(argc, argv, "Invalid <steal-depth> - must be at least 1");
+      }
+    } else if(arg == "--bbs-board") {
+      bbsBoard = true;
+    } else if(arg == "--make-unmake") {
+      makeUnmake = true;
+    } else if(arg == "--move-list") {
+      moveList = true;
     } else {
 	usage_and_die(argc, argv, "Unrecognised argument");
     }
   }
 
+  if((isTtMbSet || !ttFile.empty()) && maxTtDepth == 0) {
+    usage_and_die(argc, argv, "--tt-mb and --tt-file require --max-tt-depth");
+  }
+
+  if(!ttFile.empty() && isTtTypeLruSet) {
+    usage_and_die(argc, argv, "--tt-file can't be used with --tt-type lru");
+  }
+
+  if(!journalFile.empty() && nThreads == 0) {
+    usage_and_die(argc, argv, "--journal and --resume require --threads");
+  }
+
+  if(bbsBoard && (maxTtDepth != 0 || nThreads != 0)) {
+    usage_and_die(argc, argv, "--bbs-board can't be used with --max-tt-depth or --threads");
+  }
+
+  if(makeUnmake && (maxTtDepth != 0 || nThreads != 0 || doSplit)) {
+    usage_and_die(argc, argv, "--make-unmake can't be used with --max-tt-depth, --threads or --split");
+  }
+
+  if(moveList && !nodesOnly) {
+    usage_and_die(argc, argv, "--move-list only counts nodes - it needs --nodes-only");
+  }
+
+  if(moveList && (maxTtDepth != 0 || nThreads != 0 || doSplit || bbsBoard || makeUnmake)) {
+    usage_and_die(argc, argv, "--move-list can't be used with --max-tt-depth, --threads, --split, --bbs-board or --make-unmake");
+  }
+
   BoardUtils::printBoard<BasicBoardT>(board);
   printf("\n%s\n\n", Fen::toFen<BasicBoardT>(board, colorToMove).c_str());
   bool doNewline = false;
@@ -179,20 +417,63 @@ int main(int argc, char* argv[]) {
     doNewline = true;
   }
   if(maxTtDepth != 0) {
-    printf("  using TTs of %d partitions with %d entries at depths 3-%d\n", nTtParts, ttSize, maxTtDepth);
+    if(ttType == LocklessTt) {
+      printf("  using lockless TT of %lu MB at depths 3-%d%s%s\n", ttMb, maxTtDepth, ttFile.empty() ? "" : " backed by file ", ttFile.c_str());
+    } else {
+      printf("  using TT of %d partitions with %d entries at depths 3-%d\n", nTtParts, ttSize, maxTtDepth);
+    }
+    doNewline = true;
+  }
+  if(nodesOnly) {
+    printf("  counting nodes only\n");
     doNewline = true;
   }
   if(nThreads > 0) {
-    printf("  using %d worker threads\n", nThreads);
+    if(splitDepth == Perft::AutoSplitDepth) {
+      printf("  using %d worker threads with auto split depth and work-stealing down to depth %d\n", nThreads, maxStealDepth);
+    } else {
+      printf("  using %d worker threads with split depth %d and work-stealing down to depth %d\n", nThreads, splitDepth, maxStealDepth);
+    }
+    doNewline = true;
+  }
+  if(!journalFile.empty()) {
+    printf("  %s journal %s\n", resumeJournal ? "resuming from" : "recording to", journalFile.c_str());
+    doNewline = true;
+  }
+  if(bbsBoard) {
+    printf("  using a board with incrementally updated piece bitboards\n");
+    doNewline = true;
+  }
+  if(makeUnmake) {
+    printf("  making and unmaking moves in place\n");
+    doNewline = true;
+  }
+  if(moveList) {
+    printf("  generating move lists\n");
     doNewline = true;
   }
   if(doNewline) {
     printf("\n");
   }
 
-  auto allStats = colorToMove == White ?
-    runPerft<BasicBoardT, White>(board, depthToGo, doSplit, maxTtDepth, ttSize, nTtParts, makeMoves, nThreads) :
-    runPerft<BasicBoardT, Black>(board, depthToGo, doSplit, maxTtDepth, ttSize, nTtParts, makeMoves, nThreads);
+  std::pair<Perft::PerftStatsT, std::vector<std::pair<u64, u64>>> allStats;
+  if(moveList) {
+    allStats = colorToMove == White ?
+      runMoveListPerft<White>(board, depthToGo, makeMoves) :
+      runMoveListPerft<Black>(board, depthToGo, makeMoves);
+  } else if(makeUnmake) {
+    allStats = colorToMove == White ?
+      runMakeUnmakePerft<White>(board, depthToGo, makeMoves, nodesOnly, bbsBoard) :
+      runMakeUnmakePerft<Black>(board, depthToGo, makeMoves, nodesOnly, bbsBoard);
+  } else if(bbsBoard) {
+    allStats = colorToMove == White ?
+      runBbsBoardPerft<White>(board, depthToGo, doSplit, makeMoves, nodesOnly) :
+      runBbsBoardPerft<Black>(board, depthToGo, doSplit, makeMoves, nodesOnly);
+  } else {
+    allStats = colorToMove == White ?
+      runPerft<BasicBoardT, White>(board, depthToGo, doSplit, maxTtDepth, ttType, ttSize, nTtParts, ttMb, ttFile, makeMoves, nodesOnly, nThreads, splitDepth, maxStealDepth, journalFile, resumeJournal) :
+      runPerft<BasicBoardT, Black>(board, depthToGo, doSplit, maxTtDepth, ttType, ttSize, nTtParts, ttMb, ttFile, makeMoves, nodesOnly, nThreads, splitDepth, maxStealDepth, journalFile, resumeJournal);
+  }
 
   if(doSplit) {
     printf("\n");
@@ -201,9 +482,10 @@ int main(int argc, char* argv[]) {
   const auto& ttStats = allStats.second;
   if(maxTtDepth != 0) {
     using Perft::MinTtDepth;
+    // TT stats are by TT entry depth-to-go
     for(int i = MinTtDepth; i <= maxTtDepth; i++) {
-      u64 nodes = ttStats[i - MinTtDepth].first;
-      u64 hits = ttStats[i - MinTtDepth].second;
+      u64 nodes = ttStats[depthToGo - i].first;
+      u64 hits = ttStats[depthToGo - i].second;
       printf("Depth %d: %lu nodes, %lu TT hits - %.2f%% hit rate\n", i, nodes, hits, ((double)hits/(double)nodes)*100.0);
     }
     printf("\n");
@@ -211,5 +493,9 @@ int main(int argc, char* argv[]) {
 
   const auto& stats = allStats.first;
   printf("perft(%d) stats:\n\n", depthToGo);
-  dumpStats(stats);
+  if(nodesOnly) {
+    dumpNodes(stats);
+  } else {
+    dumpStats(stats);
+  }
 }
@@ -6,16 +6,29 @@
 #include "board-utils.hpp"
 #include "bounded-hash-map.hpp"
 #include "fen.hpp"
+#include "lockless-hash-map.hpp"
+#include "work-stealing-pool.hpp"
 #include "move-gen.hpp"
 #include "make-move.hpp"
+#include "move-list.hpp"
 #include "bits.hpp"
 
-#include <list>
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include <unistd.h>
+
 namespace Chess {
   
   namespace Perft {
@@ -57,8 +70,33 @@ namespace Chess {
     }
 
     extern void dumpStats(const Perft::PerftStatsT& stats);
+    extern void dumpNodes(const Perft::PerftStatsT& stats);
+
+    //
+    // Stats policy - AllStatsT or NodesOnlyStatsT.
+    // NodesOnlyStatsT compiles out the capture/check/checkmate bookkeeping and only PerftStatsT::nodes is valid.
+    //
+    using MakeMove::AllStatsT;
+    using MakeMove::NodesOnlyStatsT;
+
+    //
+    // Move mode - CopyMakeTag or MakeUnmakeTag - see make-move.hpp.
+    // Only plain perft supports MakeUnmakeTag.
+    //
+    using MakeMove::CopyMakeTag;
+    using MakeMove::MakeUnmakeTag;
+
+    template <typename StatsT>
+    inline void dumpStats(const Perft::PerftStatsT& stats) {
+      if(StatsT::NodesOnly) {
+	dumpNodes(stats);
+      } else {
+	dumpStats(stats);
+      }
+    }
     
     // Curiously adding just one more member here - depth - slows down perf substantially, particularly if they are int size!
+    template <typename StatsT>
     struct PerftStateT {
       PerftStatsT& stats;
       const bool makeMoves;
@@ -69,28 +107,32 @@ namespace Chess {
 	stats(stats), makeMoves(makeMoves), depth(depth), depthToGo(depthToGo) {}
     };
 
-    template <typename BoardT, ColorT Color>
-    inline void perftImpl(const PerftStateT state, const BoardT& board, const MoveInfoT moveInfo);
+    template <typename StatsT, typename BoardT, ColorT Color, typename MoveModeT = CopyMakeTag>
+    inline void perftImpl(const PerftStateT<StatsT> state, const BoardT& board, const MoveInfoT moveInfo);
   
-    template <typename BoardT, ColorT Color>
+    template <typename StatsT, typename BoardT, ColorT Color, typename MoveModeT_ = CopyMakeTag>
     struct PerftPosHandlerT {
-      typedef PerftPosHandlerT<BoardT, OtherColorT<Color>::value> ReverseT;
-      typedef PerftPosHandlerT<typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
-      typedef PerftPosHandlerT<typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
+      typedef MoveModeT_ MoveModeT;
+      typedef PerftPosHandlerT<StatsT, BoardT, OtherColorT<Color>::value, MoveModeT> ReverseT;
+      typedef PerftPosHandlerT<StatsT, typename BoardType<BoardT>::WithPromosT, Color, MoveModeT> WithPromosT;
+      typedef PerftPosHandlerT<StatsT, typename BoardType<BoardT>::WithoutPromosT, Color, MoveModeT> WithoutPromosT;
       
-      inline static void handlePos(const PerftStateT state, const BoardT& board, MoveInfoT moveInfo) {
-	perftImpl<BoardT, Color>(state, board, moveInfo);
+      inline static void handlePos(const PerftStateT<StatsT> state, const BoardT& board, MoveInfoT moveInfo) {
+	perftImpl<StatsT, BoardT, Color, MoveModeT>(state, board, moveInfo);
       }
     };
 
-    template <typename BoardT, ColorT Color>
+    template <typename StatsT, typename BoardT, ColorT Color>
     struct PerftCountHandlerT {
-      typedef PerftCountHandlerT<BoardT, OtherColorT<Color>::value> ReverseT;
-      typedef PerftCountHandlerT<typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
-      typedef PerftCountHandlerT<typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
+      typedef PerftCountHandlerT<StatsT, BoardT, OtherColorT<Color>::value> ReverseT;
+      typedef PerftCountHandlerT<StatsT, typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
+      typedef PerftCountHandlerT<StatsT, typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
       
       inline static void handleCount(PerftStatsT& stats, const u64 nodes, u64 captures, u64 eps, u64 castles, u64 promos, u64 checks, u64 discoverychecks, u64 doublechecks, u64 checkmates) {
 	stats.nodes += nodes;
+	if(StatsT::NodesOnly) {
+	  return;
+	}
 	stats.captures += captures;
 	stats.eps += eps;
 	stats.castles += castles;
@@ -102,29 +144,42 @@ namespace Chess {
       }
     };
 
-    template <typename BoardT, ColorT Color>
+    // Top-level move for --split output - promos get the promo piece appended, e.g. a7-a8q
+    inline void printSplitMove(const MoveInfoT moveInfo) {
+      if(moveInfo.isPromo()) {
+	printf("  move %s-%s%c: ", SquareStr[moveInfo.from()], SquareStr[moveInfo.to()], BoardUtils::PieceChar[(size_t)Black][moveInfo.pieceType()]);
+      } else {
+	printf("  move %s-%s: ", SquareStr[moveInfo.from()], SquareStr[moveInfo.to()]);
+      }
+    }
+
+    template <typename StatsT, typename BoardT, ColorT Color>
     inline void perft0Impl(PerftStatsT& stats, const BoardT& board, const MoveInfoT moveInfo) {
       stats.nodes++;
 
-      if(moveInfo.moveType == CaptureMove) {
+      if(StatsT::NodesOnly) {
+	return;
+      }
+
+      if(moveInfo.moveType() == CaptureMove) {
 	stats.captures++;
-      } else if(moveInfo.moveType == EpCaptureMove) {
+      } else if(moveInfo.moveType() == EpCaptureMove) {
 	stats.captures++;
 	stats.eps++;
-      } else if(moveInfo.moveType == CastlingMove) {
+      } else if(moveInfo.moveType() == CastlingMove) {
 	stats.castles++;
       }
 
-      if(moveInfo.isPromo) {
+      if(moveInfo.isPromo()) {
 	stats.promos++;
       }
 
-      if(moveInfo.isDirectCheck) {
+      if(moveInfo.isDirectCheck()) {
 	stats.checks++;
-	if(!moveInfo.isDiscoveredCheck) {
+	if(!moveInfo.isDiscoveredCheck()) {
 	  // static int nChecksDumped = 0;
 	  // if(nChecksDumped < 0) {
-	  //   printf("\nCheck - last move %s-%s %c:\n\n", SquareStr[moveInfo.from], SquareStr[moveInfo.to], BoardUtils::PieceChar[(size_t)OtherColorT<Color>::value][moveInfo.pieceType]);
+	  //   printf("\nCheck - last move %s-%s %c:\n\n", SquareStr[moveInfo.from()], SquareStr[moveInfo.to()], BoardUtils::PieceChar[(size_t)OtherColorT<Color>::value][moveInfo.pieceType()]);
 	  //   BoardUtils::printBoard(board);
 	  //   printf("\n");
 	  //   nChecksDumped++;
@@ -134,26 +189,26 @@ namespace Chess {
 	  const SquareT myKingSq = myState.basic.pieceSquares[TheKing];
 	  if(rankOf(myKingSq) == (Color == White ? 0 : 7)) {
 	    stats.directonlybackrankchecks++;
-	    if(moveInfo.pieceType == Bishop) {
+	    if(moveInfo.pieceType() == Bishop) {
 	      stats.directonlybackrankchecksbishops++;
-	    } else if(moveInfo.pieceType == Rook) {
+	    } else if(moveInfo.pieceType() == Rook) {
 	      stats.directonlybackrankchecksrooks++;
-	    } else if(moveInfo.pieceType == Queen) {
-	      if(fileOf(moveInfo.to) == fileOf(myKingSq)) {
+	    } else if(moveInfo.pieceType() == Queen) {
+	      if(fileOf(moveInfo.to()) == fileOf(myKingSq)) {
 		stats.directonlybackrankchecksqueenorthogs++;
 	      } else {
 		stats.directonlybackrankchecksqueendiags++;
 	      }
-	    } else if(moveInfo.pieceType == Knight) {
+	    } else if(moveInfo.pieceType() == Knight) {
 	      stats.directonlybackrankchecksknights++;
 	    } 
 	  }
 	}
       }
       
-      if(moveInfo.isDiscoveredCheck) {
+      if(moveInfo.isDiscoveredCheck()) {
 	// Double checks are counted independently of discoveries
-	if(moveInfo.isDirectCheck) {
+	if(moveInfo.isDirectCheck()) {
 	  stats.doublechecks++;
 	} else {
 	  stats.checks++;
@@ -163,7 +218,7 @@ namespace Chess {
 
       static const bool DoCheckMateStats = true;
       if(DoCheckMateStats) {
-	if(moveInfo.isDirectCheck || moveInfo.isDiscoveredCheck) {
+	if(moveInfo.isCheck()) {
 	  // It's checkmate if there are no legal moves
 	  if(!BoardUtils::hasLegalMoves<BoardT, Color>(board)) {
 	    stats.checkmates++;
@@ -172,67 +227,105 @@ namespace Chess {
       }
     }
 
-    template <typename BoardT, ColorT Color>
+    template <typename StatsT, typename BoardT, ColorT Color>
     inline void perft1Impl(PerftStatsT& stats, const BoardT& board) {
-      MakeMove::countAllLegalMoves<PerftStatsT&, PerftCountHandlerT<BoardT, Color>, BoardT, Color>(stats, board);
+      MakeMove::countAllLegalMoves<PerftStatsT&, PerftCountHandlerT<StatsT, BoardT, Color>, BoardT, Color, StatsT>(stats, board);
     }
     
-    template <typename BoardT, ColorT Color>
-    inline void perftImplFull(const PerftStateT state, const BoardT& board) {
+    template <typename StatsT, typename BoardT, ColorT Color, typename MoveModeT = CopyMakeTag>
+    inline void perftImplFull(const PerftStateT<StatsT> state, const BoardT& board) {
       
-      const PerftStateT newState(state.stats, state.makeMoves, state.depth+1, state.depthToGo-1);
+      const PerftStateT<StatsT> newState(state.stats, state.makeMoves, state.depth+1, state.depthToGo-1);
       
-      MakeMove::makeAllLegalMoves<const PerftStateT, PerftPosHandlerT<BoardT, Color>, BoardT, Color>(newState, board);
+      MakeMove::makeAllLegalMoves<const PerftStateT<StatsT>, PerftPosHandlerT<StatsT, BoardT, Color, MoveModeT>, BoardT, Color, StatsT>(newState, board);
     }
 
     //const bool DoDepth1Count = true;
 
-    template <typename BoardT, ColorT Color>
-    inline void perftImpl(const PerftStateT state, const BoardT& board, const MoveInfoT moveInfo) {
+    template <typename StatsT, typename BoardT, ColorT Color, typename MoveModeT>
+    inline void perftImpl(const PerftStateT<StatsT> state, const BoardT& board, const MoveInfoT moveInfo) {
       // If this is a leaf node, gather stats.
       if(state.depthToGo == 0) {
-	perft0Impl<BoardT, Color>(state.stats, board, moveInfo);
+	perft0Impl<StatsT, BoardT, Color>(state.stats, board, moveInfo);
       } else if(state.depthToGo == 1 && !state.makeMoves) {
-	perft1Impl<BoardT, Color>(state.stats, board);
+	perft1Impl<StatsT, BoardT, Color>(state.stats, board);
       } else {
-	perftImplFull<BoardT, Color>(state, board);
+	perftImplFull<StatsT, BoardT, Color, MoveModeT>(state, board);
       }
     }
       
-    template <typename BoardT, ColorT Color>
+    template <typename StatsT, typename BoardT, ColorT Color, typename MoveModeT = CopyMakeTag>
     inline PerftStatsT perft(const BoardT& board, const int depthToGo, const bool makeMoves) {
       PerftStatsT stats = {};
       const int nChecks = BoardUtils::getNChecks<BoardT, Color>(board);
       MoveInfoT dummyMoveInfo(PushMove, NoPieceType, /*from*/InvalidSquare, /*to*/InvalidSquare, /*isDirectCheck*/(nChecks > 0), /*isDiscoveredCheck*/(nChecks > 1));
-      const PerftStateT state(stats, makeMoves, 0, depthToGo);
+      const PerftStateT<StatsT> state(stats, makeMoves, 0, depthToGo);
 
-      perftImpl<BoardT, Color>(state, board, dummyMoveInfo);
+      // Make/unmake makes moves in place on the board so work on our own copy
+      BoardT rootBoard = board;
+      perftImpl<StatsT, BoardT, Color, MoveModeT>(state, rootBoard, dummyMoveInfo);
 
       return stats;
     }
 
     //
-    // Split perft implementation
+    // Move list perft - generates each move list with MoveList::genLegalMoveList() and makes each move with
+    //   MoveList::makeMove(), for comparison against the callback-style makeAllLegalMoves().
+    // Nodes only - the packed moves don't carry check info - and always on a FullBoardT - see move-list.hpp.
     //
 
+    template <ColorT Color>
+    inline u64 moveListPerftImpl(const FullBoardT& board, const int depthToGo, const bool makeMoves) {
+      if(depthToGo == 0) {
+	return 1;
+      }
+
+      MoveList::MoveListT moveList;
+      MoveList::genLegalMoveList<FullBoardT, Color>(board, moveList);
+
+      if(depthToGo == 1 && !makeMoves) {
+	return moveList.size;
+      }
+
+      u64 nodes = 0;
+      for(int i = 0; i < moveList.size; i++) {
+	const FullBoardT newBoard = MoveList::makeMove<Color>(board, moveList.moves[i]);
+	nodes += moveListPerftImpl<OtherColorT<Color>::value>(newBoard, depthToGo-1, makeMoves);
+      }
+
+      return nodes;
+    }
+
     template <typename BoardT, ColorT Color>
-    inline void splitPerftImpl(const PerftStateT state, const BoardT& board, const MoveInfoT moveInfo);
+    inline PerftStatsT moveListPerft(const BoardT& board, const int depthToGo, const bool makeMoves) {
+      PerftStatsT stats = {};
+      stats.nodes = moveListPerftImpl<Color>(copyBoard<FullBoardT, BoardT>(board), depthToGo, makeMoves);
+
+      return stats;
+    }
+
+    //
+    // Split perft implementation
+    //
+
+    template <typename StatsT, typename BoardT, ColorT Color>
+    inline void splitPerftImpl(const PerftStateT<StatsT> state, const BoardT& board, const MoveInfoT moveInfo);
   
-    template <typename BoardT, ColorT Color>
+    template <typename StatsT, typename BoardT, ColorT Color>
     struct SplitPerftPosHandlerT {
-      typedef SplitPerftPosHandlerT<BoardT, OtherColorT<Color>::value> ReverseT;
-      typedef SplitPerftPosHandlerT<typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
-      typedef SplitPerftPosHandlerT<typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
+      typedef SplitPerftPosHandlerT<StatsT, BoardT, OtherColorT<Color>::value> ReverseT;
+      typedef SplitPerftPosHandlerT<StatsT, typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
+      typedef SplitPerftPosHandlerT<StatsT, typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
       
-      inline static void handlePos(const PerftStateT state, const BoardT& board, MoveInfoT moveInfo) {
+      inline static void handlePos(const PerftStateT<StatsT> state, const BoardT& board, MoveInfoT moveInfo) {
 	PerftStatsT splitStats = {};
-	const PerftStateT splitState(splitStats, state.makeMoves, state.depth, state.depthToGo);
+	const PerftStateT<StatsT> splitState(splitStats, state.makeMoves, state.depth, state.depthToGo);
 	
-	splitPerftImpl<BoardT, Color>(splitState, board, moveInfo);
+	splitPerftImpl<StatsT, BoardT, Color>(splitState, board, moveInfo);
 
 	if(state.depth == 1) {
-	  printf("  move %s-%s: ", SquareStr[moveInfo.from], SquareStr[moveInfo.to]);
-	  dumpStats(splitStats);
+	  printSplitMove(moveInfo);
+	  dumpStats<StatsT>(splitStats);
 	}
 
 	// Accumulate the stats
@@ -240,34 +333,34 @@ namespace Chess {
       }
     };
 
-    template <typename BoardT, ColorT Color>
-    inline void splitPerftImplFull(const PerftStateT state, const BoardT& board) {
+    template <typename StatsT, typename BoardT, ColorT Color>
+    inline void splitPerftImplFull(const PerftStateT<StatsT> state, const BoardT& board) {
       
-      const PerftStateT newState(state.stats, state.makeMoves, state.depth+1, state.depthToGo-1);
+      const PerftStateT<StatsT> newState(state.stats, state.makeMoves, state.depth+1, state.depthToGo-1);
 
-      MakeMove::makeAllLegalMoves<const PerftStateT, SplitPerftPosHandlerT<BoardT, Color>, BoardT, Color>(newState, board);
+      MakeMove::makeAllLegalMoves<const PerftStateT<StatsT>, SplitPerftPosHandlerT<StatsT, BoardT, Color>, BoardT, Color, StatsT>(newState, board);
     }
 
-    template <typename BoardT, ColorT Color>
-    inline void splitPerftImpl(const PerftStateT state, const BoardT& board, const MoveInfoT moveInfo) {
+    template <typename StatsT, typename BoardT, ColorT Color>
+    inline void splitPerftImpl(const PerftStateT<StatsT> state, const BoardT& board, const MoveInfoT moveInfo) {
       // If this is a leaf node, gather stats.
       if(state.depthToGo == 0) {
-	perft0Impl<BoardT, Color>(state.stats, board, moveInfo);
+	perft0Impl<StatsT, BoardT, Color>(state.stats, board, moveInfo);
 	} else if(state.depth < 2) {
-	splitPerftImplFull<BoardT, Color>(state, board);
+	splitPerftImplFull<StatsT, BoardT, Color>(state, board);
       } else {
-	perftImpl<BoardT, Color>(state, board, moveInfo);
+	perftImpl<StatsT, BoardT, Color>(state, board, moveInfo);
       }
     }
       
-    template <typename BoardT, ColorT Color>
+    template <typename StatsT, typename BoardT, ColorT Color>
     inline PerftStatsT splitPerft(const BoardT& board, const int depthToGo, const bool makeMoves) {
       PerftStatsT stats = {};
       const int nChecks = BoardUtils::getNChecks<BoardT, Color>(board);
       MoveInfoT dummyMoveInfo(PushMove, NoPieceType, /*from*/InvalidSquare, /*to*/InvalidSquare, /*isDirectCheck*/(nChecks > 0), /*isDiscoveredCheck*/(nChecks > 1));
-      const PerftStateT state(stats, makeMoves, 0, depthToGo);
+      const PerftStateT<StatsT> state(stats, makeMoves, 0, depthToGo);
 
-      splitPerftImpl<BoardT, Color>(state, board, dummyMoveInfo);
+      splitPerftImpl<StatsT, BoardT, Color>(state, board, dummyMoveInfo);
 
       return stats;
     }
@@ -275,68 +368,231 @@ namespace Chess {
     //
     // Perft with transition tables
     //
-    // We maintain a separate TT per depth
+    // A single TT serves all depths - entries are tagged with the remaining depth (depthToGo) of the subtree.
+    //
+    // The TT implementation is a template parameter TtT which provides:
+    //
+    //   typedef blah KeyT;
+    //   template <typename BoardT, ColorT Color> static KeyT genKey(const BoardT& board, const int depthToGo);
+    //   bool copy_if_present(const KeyT& key, const int depthToGo, PerftStatsT& stats);
+    //   void put(const KeyT& key, const int depthToGo, const PerftStatsT& stats);
     //
 
+    const int MinTtDepth = 3;
+    
     using BoundedHashMap::BoundedHashMap;
 
+    // LRU TT keyed on (trimmed) FEN and depth-to-go, partitioned with a mutex per partition
+    struct LruPerftTtT {
+      typedef std::string KeyT;
+
+      std::vector<BoundedHashMap<std::string, PerftStatsT>> tts; // indexed on tts[partition]
+
+      LruPerftTtT(const int ttSize, const int nTtParts) {
+	for(int partNo = 0; partNo < nTtParts; partNo++) {
+	  tts.push_back(BoundedHashMap<std::string, PerftStatsT>(ttSize));
+	}
+      }
+
+      template <typename BoardT, ColorT Color>
+      static std::string genKey(const BoardT& board, const int depthToGo) {
+	// Omit the EP square in cases where EP capture is impossible - this gives us more transpositions
+	return Fen::toFenFast<BoardT>(board, Color, /*trimEp*/true) + " " + std::to_string(depthToGo);
+      }
+
+      BoundedHashMap<std::string, PerftStatsT>& partition(const std::string& key) {
+	const size_t partMask = tts.size() - 1;
+	return tts[std::hash<std::string>{}(key) & partMask];
+      }
+
+      // The depth is already in the key
+      bool copy_if_present(const std::string& key, const int depthToGo, PerftStatsT& stats) {
+	return partition(key).copy_if_present(key, stats);
+      }
+
+      void put(const std::string& key, const int depthToGo, const PerftStatsT& stats) {
+	partition(key).put(key, stats);
+      }
+    };
+
+    // The stats that addAll() accumulates - this is all we keep in the lock-free TT - tagged with the subtree depth
+    struct PerftTtStatsT {
+      u64 depthToGo;
+      u64 nodes;
+      u64 captures;
+      u64 eps;
+      u64 castles;
+      u64 promos;
+      u64 checks;
+      u64 discoverychecks;
+      u64 doublechecks;
+      u64 checkmates;
+    };
+
+    // Replacement weight is subtree size - big subtrees are expensive to recompute
+    struct PerftTtStatsWeightFn {
+      static u64 fn(const PerftTtStatsT& ttStats) { return ttStats.nodes; }
+    };
+
+    // Nodes-only TT value - depth-to-go in the top 8 bits and the node count below - one word so 4 entries per cache line
+    struct PerftTtNodesT {
+      u64 depthAndNodes;
+    };
+
+    const int PerftTtNodesDepthShift = 56;
+    const u64 PerftTtNodesMask = (1ULL << PerftTtNodesDepthShift) - 1;
+
+    struct PerftTtNodesWeightFn {
+      static u64 fn(const PerftTtNodesT& ttNodes) { return ttNodes.depthAndNodes & PerftTtNodesMask; }
+    };
+
+    // Lock-free TT value representation for each stats policy
+    template <typename StatsT>
+    struct PerftTtValImplT;
+
+    // Persisted TT files are only reused with the same value scheme - bump PerftTtFileVersion if the TT key or value layout changes
+    const u64 PerftTtFileVersion = 1;
+
+    template <>
+    struct PerftTtValImplT<AllStatsT> {
+      typedef PerftTtStatsT ValT;
+      typedef PerftTtStatsWeightFn WeightFnT;
+      static const u64 FileScheme = PerftTtFileVersion << 8 | 1;
+
+      static ValT toTt(const int depthToGo, const PerftStatsT& stats) {
+	const PerftTtStatsT ttStats = { (u64)depthToGo, stats.nodes, stats.captures, stats.eps, stats.castles, stats.promos, stats.checks, stats.discoverychecks, stats.doublechecks, stats.checkmates };
+	return ttStats;
+      }
+
+      static bool fromTt(const ValT& ttStats, const int depthToGo, PerftStatsT& stats) {
+	if(ttStats.depthToGo != (u64)depthToGo) {
+	  return false;
+	}
+	
+	stats.nodes = ttStats.nodes;
+	stats.captures = ttStats.captures;
+	stats.eps = ttStats.eps;
+	stats.castles = ttStats.castles;
+	stats.promos = ttStats.promos;
+	stats.checks = ttStats.checks;
+	stats.discoverychecks = ttStats.discoverychecks;
+	stats.doublechecks = ttStats.doublechecks;
+	stats.checkmates = ttStats.checkmates;
+
+	return true;
+      }
+    };
+
+    template <>
+    struct PerftTtValImplT<NodesOnlyStatsT> {
+      typedef PerftTtNodesT ValT;
+      typedef PerftTtNodesWeightFn WeightFnT;
+      static const u64 FileScheme = PerftTtFileVersion << 8 | 2;
+
+      static ValT toTt(const int depthToGo, const PerftStatsT& stats) {
+	const PerftTtNodesT ttNodes = { ((u64)depthToGo << PerftTtNodesDepthShift) | (stats.nodes & PerftTtNodesMask) };
+	return ttNodes;
+      }
+
+      static bool fromTt(const ValT& ttNodes, const int depthToGo, PerftStatsT& stats) {
+	if((ttNodes.depthAndNodes >> PerftTtNodesDepthShift) != (u64)depthToGo) {
+	  return false;
+	}
+
+	stats.nodes = ttNodes.depthAndNodes & PerftTtNodesMask;
+
+	return true;
+      }
+    };
+
+    // Mix the depth-to-go into the key so that the same position at different depths has different entries
+    const u64 PerftTtDepthKeyMultiplier = 0x9e3779b97f4a7c15ULL;
+
+    using LocklessHashMap::LocklessHashMap;
+
+    // Lock-free TT keyed on Zobrist key, pre-allocated and shared by all threads and all depths
+    // Entries are sized for the stats policy - nodes-only entries are a single counter.
+    // Optionally backed by a file so that results carry over to later runs - from any root position since keys don't depend on it.
+    template <typename StatsT>
+    struct LocklessPerftTtT {
+      typedef u64 KeyT;
+      typedef PerftTtValImplT<StatsT> ValImplT;
+      typedef typename ValImplT::ValT ValT;
+
+      LocklessHashMap<ValT, typename ValImplT::WeightFnT> tt;
+
+      LocklessPerftTtT(const size_t ttMb): tt(ttMb << 20) {}
+
+      LocklessPerftTtT(const size_t ttMb, const std::string& ttFile): tt(ttMb << 20, ttFile, Zobrist::ZobristSchemeVersion, ValImplT::FileScheme) {}
+
+      // True iff the TT was warm-started from an existing file
+      bool isLoaded() const { return tt.is_loaded(); }
+
+      template <typename BoardT, ColorT Color>
+      static u64 genKey(const BoardT& board, const int depthToGo) {
+	return board.zobristKey ^ Zobrist::colorToMoveKey(Color) ^ (PerftTtDepthKeyMultiplier * (u64)depthToGo);
+      }
+
+      bool copy_if_present(const u64 key, const int depthToGo, PerftStatsT& stats) {
+	ValT ttVal;
+	return tt.copy_if_present(key, ttVal) && ValImplT::fromTt(ttVal, depthToGo, stats);
+      }
+
+      void put(const u64 key, const int depthToGo, const PerftStatsT& stats) {
+	tt.put(key, ValImplT::toTt(depthToGo, stats));
+      }
+    };
+
+    template <typename StatsT, typename TtT>
     struct TtPerftStateT {
       PerftStatsT& stats;
-      std::vector<std::vector<BoundedHashMap<std::string, PerftStatsT>>>& tts; // indexed on tts[partition][depth-MinTtDepth]
-      std::vector<std::pair<u64, u64>>& ttStats; // (total-nodes, ht-hits)
+      TtT& tt;
+      std::vector<std::pair<u64, u64>>& ttStats; // (total-nodes, ht-hits) indexed by depth-to-go
       const bool doSplit;
       const bool makeMoves;
       const u8 maxTtDepth;
       const u8 depth;
       const u8 depthToGo;
 
-      TtPerftStateT(PerftStatsT& stats, std::vector<std::vector<BoundedHashMap<std::string, PerftStatsT>>>& tts, std::vector<std::pair<u64, u64>>& ttStats, const bool doSplit, const bool makeMoves, const u8 maxTtDepth, const u8 depth, const u8 depthToGo):
-	stats(stats), tts(tts), ttStats(ttStats), doSplit(doSplit), makeMoves(makeMoves), maxTtDepth(maxTtDepth), depth(depth), depthToGo(depthToGo) {}
+      TtPerftStateT(PerftStatsT& stats, TtT& tt, std::vector<std::pair<u64, u64>>& ttStats, const bool doSplit, const bool makeMoves, const u8 maxTtDepth, const u8 depth, const u8 depthToGo):
+	stats(stats), tt(tt), ttStats(ttStats), doSplit(doSplit), makeMoves(makeMoves), maxTtDepth(maxTtDepth), depth(depth), depthToGo(depthToGo) {}
     };
 
-    const int MinTtDepth = 3;
-    
-    template <typename BoardT, ColorT Color>
-    inline void ttPerftImpl(const TtPerftStateT state, const BoardT& board, const MoveInfoT moveInfo);
+    template <typename StatsT, typename TtT, typename BoardT, ColorT Color>
+    inline void ttPerftImpl(const TtPerftStateT<StatsT, TtT> state, const BoardT& board, const MoveInfoT moveInfo);
   
-    template <typename BoardT, ColorT Color>
+    template <typename StatsT, typename TtT, typename BoardT, ColorT Color>
     struct TtPerftPosHandlerT {
-      typedef TtPerftPosHandlerT<BoardT, OtherColorT<Color>::value> ReverseT;
-      typedef TtPerftPosHandlerT<typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
-      typedef TtPerftPosHandlerT<typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
+      typedef TtPerftPosHandlerT<StatsT, TtT, BoardT, OtherColorT<Color>::value> ReverseT;
+      typedef TtPerftPosHandlerT<StatsT, TtT, typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
+      typedef TtPerftPosHandlerT<StatsT, TtT, typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
       
-      inline static void handlePos(const TtPerftStateT state, const BoardT& board, MoveInfoT moveInfo) {
+      inline static void handlePos(const TtPerftStateT<StatsT, TtT> state, const BoardT& board, MoveInfoT moveInfo) {
 	PerftStatsT splitStats = {};
 
 	bool foundIt = false;
-	std::string fen;
-	const size_t nParts = state.tts.size();
-	const size_t partMask = nParts - 1;
-	size_t part = 0;
+	typename TtT::KeyT key = {};
 
-	// Probe the TT
-	const int ttIndex = state.depth - MinTtDepth;
+	// Probe the TT - we don't bother at shallow depths since no transpositions are possible
 	if(MinTtDepth <= state.depth && state.depth <= state.maxTtDepth) {
-	  state.ttStats[ttIndex].first++;
-	  // Omit the EP square in cases where EP capture is impossible - this gives us more transpositions
-	  fen = Fen::toFenFast<BoardT>(board, Color, /*trimEp*/true);
-	  part = std::hash<std::string>{}(fen) & partMask;
-	  foundIt = state.tts[part][ttIndex].copy_if_present(fen, splitStats);
+	  state.ttStats[state.depthToGo].first++;
+	  key = TtT::template genKey<BoardT, Color>(board, state.depthToGo);
+	  foundIt = state.tt.copy_if_present(key, state.depthToGo, splitStats);
 	  if(foundIt) {
-	    state.ttStats[ttIndex].second++;
+	    state.ttStats[state.depthToGo].second++;
 	  }
 	}
 
 	// If it's not in the TT then compute it
 	if(!foundIt) {
-	  const TtPerftStateT splitState(splitStats, state.tts, state.ttStats, state.doSplit, state. makeMoves, state.maxTtDepth, state.depth, state.depthToGo);
+	  const TtPerftStateT<StatsT, TtT> splitState(splitStats, state.tt, state.ttStats, state.doSplit, state. makeMoves, state.maxTtDepth, state.depth, state.depthToGo);
 	
-	  ttPerftImpl<BoardT, Color>(splitState, board, moveInfo);
+	  ttPerftImpl<StatsT, TtT, BoardT, Color>(splitState, board, moveInfo);
 	}
 	
 	if(state.doSplit && state.depth == 1) {
-	  printf("  move %s-%s: ", SquareStr[moveInfo.from], SquareStr[moveInfo.to]);
-	  dumpStats(splitStats);
+	  printSplitMove(moveInfo);
+	  dumpStats<StatsT>(splitStats);
 	}
 
 	// Accumulate the stats
@@ -344,200 +600,621 @@ namespace Chess {
 
 	// If it's not in the TT then insert it
 	if(MinTtDepth <= state.depth && state.depth <= state.maxTtDepth && !foundIt) {
-	  state.tts[part][ttIndex].put(fen, splitStats);
+	  state.tt.put(key, state.depthToGo, splitStats);
 	}
       }
     };
 
-    template <typename BoardT, ColorT Color>
-    inline void ttPerftImplFull(const TtPerftStateT state, const BoardT& board) {
+    template <typename StatsT, typename TtT, typename BoardT, ColorT Color>
+    inline void ttPerftImplFull(const TtPerftStateT<StatsT, TtT> state, const BoardT& board) {
       
-      const TtPerftStateT newState(state.stats, state.tts, state.ttStats, state.doSplit, state.makeMoves, state.maxTtDepth, state.depth+1, state.depthToGo-1);
+      const TtPerftStateT<StatsT, TtT> newState(state.stats, state.tt, state.ttStats, state.doSplit, state.makeMoves, state.maxTtDepth, state.depth+1, state.depthToGo-1);
 
-      MakeMove::makeAllLegalMoves<const TtPerftStateT, TtPerftPosHandlerT<BoardT, Color>, BoardT, Color>(newState, board);
+      MakeMove::makeAllLegalMoves<const TtPerftStateT<StatsT, TtT>, TtPerftPosHandlerT<StatsT, TtT, BoardT, Color>, BoardT, Color, StatsT>(newState, board);
     }
 
-    template <typename BoardT, ColorT Color>
-    inline void ttPerftImpl(const TtPerftStateT state, const BoardT& board, const MoveInfoT moveInfo) {
+    template <typename StatsT, typename TtT, typename BoardT, ColorT Color>
+    inline void ttPerftImpl(const TtPerftStateT<StatsT, TtT> state, const BoardT& board, const MoveInfoT moveInfo) {
       // If this is a leaf node, gather stats.
       if(state.depthToGo == 0) {
-	perft0Impl<BoardT, Color>(state.stats, board, moveInfo);
+	perft0Impl<StatsT, BoardT, Color>(state.stats, board, moveInfo);
       } else if(state.depth <= state.maxTtDepth) {
-	ttPerftImplFull<BoardT, Color>(state, board);
+	ttPerftImplFull<StatsT, TtT, BoardT, Color>(state, board);
       } else {
-	PerftStateT perftState(state.stats, state.makeMoves, state.depth, state.depthToGo);
-	perftImpl<BoardT, Color>(perftState, board, moveInfo);
+	PerftStateT<StatsT> perftState(state.stats, state.makeMoves, state.depth, state.depthToGo);
+	perftImpl<StatsT, BoardT, Color>(perftState, board, moveInfo);
       }
     }
       
-    template <typename BoardT, ColorT Color>
-    inline PerftStatsT ttPerft(const BoardT& board, const MoveInfoT moveInfo, std::vector<std::vector<BoundedHashMap<std::string, PerftStatsT>>>& tts, std::vector<std::pair<u64, u64>>& ttStats, const bool doSplit, const bool makeMoves, const int maxTtDepth, const int depth, const int depthToGo) {
+    template <typename StatsT, typename TtT, typename BoardT, ColorT Color>
+    inline PerftStatsT ttPerft(const BoardT& board, const MoveInfoT moveInfo, TtT& tt, std::vector<std::pair<u64, u64>>& ttStats, const bool doSplit, const bool makeMoves, const int maxTtDepth, const int depth, const int depthToGo) {
       PerftStatsT stats = {};
-      const TtPerftStateT state(stats, tts, ttStats, doSplit, makeMoves, maxTtDepth, depth, depthToGo);
+      const TtPerftStateT<StatsT, TtT> state(stats, tt, ttStats, doSplit, makeMoves, maxTtDepth, depth, depthToGo);
 
-      ttPerftImpl<BoardT, Color>(state, board, moveInfo);
+      ttPerftImpl<StatsT, TtT, BoardT, Color>(state, board, moveInfo);
 	
       return stats;
     }
 
-    template <typename BoardT, ColorT Color>
-    inline std::pair<PerftStatsT, std::vector<std::pair<u64, u64>>> ttPerft(const BoardT& board, const int depthToGo, const bool doSplit, const bool makeMoves, const int maxTtDepth, const int ttSize, const int nTtParts) {
-
-      std::vector<std::vector<BoundedHashMap<std::string, PerftStatsT>>> tts(nTtParts);
+    template <typename StatsT, typename TtT, typename BoardT, ColorT Color>
+    inline std::pair<PerftStatsT, std::vector<std::pair<u64, u64>>> ttPerft(const BoardT& board, const int depthToGo, const bool doSplit, const bool makeMoves, const int maxTtDepth, TtT& tt) {
 
-      for(int partNo = 0; partNo < nTtParts; partNo++) {
-	// map: fen->stats for each depth for each partition
-	for(int i = MinTtDepth; i <= maxTtDepth; i++) {
-	  tts[partNo].push_back(BoundedHashMap<std::string, PerftStatsT>(ttSize));
-	}
-      }
-      std::vector<std::pair<u64, u64>> ttStats(maxTtDepth-MinTtDepth+1);
+      std::vector<std::pair<u64, u64>> ttStats(depthToGo+1);
       
       const int nChecks = BoardUtils::getNChecks<BoardT, Color>(board);
       MoveInfoT dummyMoveInfo(PushMove, NoPieceType, /*from*/InvalidSquare, /*to*/InvalidSquare, /*isDirectCheck*/(nChecks > 0), /*isDiscoveredCheck*/(nChecks > 1));
 
-      PerftStatsT stats = ttPerft<BoardT, Color>(board, dummyMoveInfo, tts, ttStats, doSplit, makeMoves, maxTtDepth, /*depth*/0, depthToGo);
+      PerftStatsT stats = ttPerft<StatsT, TtT, BoardT, Color>(board, dummyMoveInfo, tt, ttStats, doSplit, makeMoves, maxTtDepth, /*depth*/0, depthToGo);
 
       return std::make_pair(stats, ttStats);
     }
     
+    //
+    // Journal of completed parallel perft work items - so that an interrupted run can be resumed
+    //
+    // The file is a header followed by fixed-size records, each with a check word so that a torn record
+    //   at the end of a killed run's journal is detected and dropped.
+    // Records are keyed on position (Zobrist key including color to move) and depth-to-go, like the TT, so they
+    //   don't depend on the root position or the split depth.
+    //
+    const u64 PerftJournalMagic = 0x6c6e72756f6a7470ULL; // "ptjournl"
+    // Bump this if the journal layout changes
+    const u64 PerftJournalVersion = 1;
+    // Seconds between fsync's of the journal
+    const int PerftJournalSyncSecs = 5;
+
+    struct PerftJournalHeaderT {
+      u64 magic;
+      u64 version;
+      u64 keyScheme;
+      u64 nodesOnly;
+    };
+
+    struct PerftJournalRecordT {
+      u64 key;
+      PerftTtStatsT stats; // including depthToGo
+      u64 check; // magic ^ key ^ all stats words
+    };
+
+    inline u64 perftJournalRecordCheck(const PerftJournalRecordT& record) {
+      u64 words[sizeof(PerftTtStatsT)/sizeof(u64)];
+      memcpy(words, &record.stats, sizeof(PerftTtStatsT));
+      u64 check = PerftJournalMagic ^ record.key;
+      for(size_t i = 0; i < sizeof(PerftTtStatsT)/sizeof(u64); i++) {
+	check ^= words[i] * (2*i + 1);
+      }
+      return check;
+    }
+
+    class PerftJournalT {
+      const std::string path;
+      const bool resumed;
+      FILE* file;
+      std::mutex m;
+      // Completed items loaded from an existing journal - by position key and depth-to-go
+      std::unordered_map<u64, PerftTtStatsT> completed;
+      std::chrono::steady_clock::time_point lastSync;
+
+      static void throwErrno(const std::string& what, const std::string& path) {
+	throw std::runtime_error(what + " '" + path + "': " + strerror(errno));
+      }
+
+      static u64 completedKey(const u64 key, const int depthToGo) {
+	return key ^ (PerftTtDepthKeyMultiplier * (u64)depthToGo);
+      }
+
+      // Load all complete records, returning the file length up to the last good record
+      long load(const bool nodesOnly) {
+	FILE* in = fopen(path.c_str(), "rb");
+	if(!in) {
+	  throwErrno("Failed to open journal", path);
+	}
+
+	PerftJournalHeaderT header;
+	if(fread(&header, sizeof(header), 1, in) != 1 || header.magic != PerftJournalMagic || header.version != PerftJournalVersion) {
+	  fclose(in);
+	  throw std::runtime_error("Invalid journal '" + path + "'");
+	}
+	if(header.keyScheme != Zobrist::ZobristSchemeVersion || header.nodesOnly != (u64)nodesOnly) {
+	  fclose(in);
+	  throw std::runtime_error("Journal '" + path + "' was written with a different hash scheme or --nodes-only setting");
+	}
+
+	long goodLength = sizeof(header);
+	PerftJournalRecordT record;
+	while(fread(&record, sizeof(record), 1, in) == 1 && record.check == perftJournalRecordCheck(record)) {
+	  completed[completedKey(record.key, record.stats.depthToGo)] = record.stats;
+	  goodLength += sizeof(record);
+	}
+
+	fclose(in);
+	return goodLength;
+      }
+      
+      void sync() {
+	fflush(file);
+	fsync(fileno(file));
+	lastSync = std::chrono::steady_clock::now();
+      }
+
+    public:
+      // Start a new journal, or else resume an existing one - dropping any torn record at the end
+      PerftJournalT(const std::string& path, const bool nodesOnly, const bool resume): path(path), resumed(resume), file(0) {
+	if(resume) {
+	  const long goodLength = load(nodesOnly);
+	  if(truncate(path.c_str(), goodLength) != 0) {
+	    throwErrno("Failed to truncate journal", path);
+	  }
+	  file = fopen(path.c_str(), "ab");
+	  if(!file) {
+	    throwErrno("Failed to open journal", path);
+	  }
+	} else {
+	  file = fopen(path.c_str(), "wb");
+	  if(!file) {
+	    throwErrno("Failed to create journal", path);
+	  }
+	  const PerftJournalHeaderT header = { PerftJournalMagic, PerftJournalVersion, Zobrist::ZobristSchemeVersion, (u64)nodesOnly };
+	  fwrite(&header, sizeof(header), 1, file);
+	}
+	// Unbuffered so that each record reaches the OS as soon as the item completes - a killed run loses only in-flight items.
+	// The periodic fsync is then just for machine crashes.
+	setvbuf(file, 0, _IONBF, 0);
+	sync();
+      }
+
+      ~PerftJournalT() {
+	sync();
+	fclose(file);
+      }
+
+      size_t nCompleted() const { return completed.size(); }
+
+      // True iff we're resuming an existing journal rather than starting a new one
+      bool isResumed() const { return resumed; }
+
+      bool lookup(const u64 key, const int depthToGo, PerftStatsT& stats) const {
+	auto it = completed.find(completedKey(key, depthToGo));
+	return it != completed.end() && PerftTtValImplT<AllStatsT>::fromTt(it->second, depthToGo, stats);
+      }
+
+      // Thread-safe
+      void append(const u64 key, const int depthToGo, const PerftStatsT& stats) {
+	PerftJournalRecordT record = { key, PerftTtValImplT<AllStatsT>::toTt(depthToGo, stats), 0 };
+	record.check = perftJournalRecordCheck(record);
+	
+	std::unique_lock<std::mutex> lock(m);
+	fwrite(&record, sizeof(record), 1, file);
+	if(std::chrono::steady_clock::now() - lastSync >= std::chrono::seconds(PerftJournalSyncSecs)) {
+	  sync();
+	}
+      }
+    };
+    
     //
     // Parallel perft
     //
-    struct Depth2CollectorStateT {
-      std::list<std::pair<std::string, MoveInfoT>>& depth2FensAndMoves;
+    // All positions at the split depth are collected up front as work items, and are then computed by a work-stealing pool.
+    // The split depth is either fixed, or else chosen automatically as the shallowest depth with enough items per thread.
+    // Positions are passed around as binary boards - BasicBoardT or FullBoardT - so there's no FEN round-trip and promos are fine.
+    // Transposed positions are merged into one item with a multiplicity, and items are run largest-first
+    //   according to a cheap shallow perft estimate, so that the biggest subtrees don't start last.
+    // While other workers are idle, a busy worker splits its current subtree by pushing child subtrees onto its own deque
+    //   for idle workers to steal - down to maxStealDepth. This keeps all workers busy to the end even when a few items are huge.
+    // All tasks from the same item accumulate into that item's pre-allocated result slot.
+    // Optionally each completed item is appended to a journal, and items already in a journal we're resuming are skipped.
+    // The total is then the multiplicity-weighted sum of the item results; for split output we walk down to the split depth
+    //   again in the same (deterministic) move order to accumulate the per-item results for each top-level move.
+    //
+
+    // A position on either board type, with the color to move and the Zobrist key including the color to move
+    struct ParaPerftPosT {
+      union {
+	BasicBoardT basicBoard;
+	FullBoardT fullBoard;
+      };
+      bool isFull;
+      ColorT color;
+      ZobristKeyT key;
+    };
+
+    inline ParaPerftPosT makeParaPerftPos(const BasicBoardT& board, const ColorT color) {
+      ParaPerftPosT pos;
+      pos.basicBoard = board;
+      pos.isFull = false;
+      pos.color = color;
+      pos.key = board.zobristKey ^ Zobrist::colorToMoveKey(color);
+      return pos;
+    }
+
+    inline ParaPerftPosT makeParaPerftPos(const FullBoardT& board, const ColorT color) {
+      ParaPerftPosT pos;
+      pos.fullBoard = board;
+      pos.isFull = true;
+      pos.color = color;
+      pos.key = board.zobristKey ^ Zobrist::colorToMoveKey(color);
+      return pos;
+    }
+
+    // A unique work item at the split depth - the item number is its index in the item list
+    struct ParaPerftItemT {
+      ParaPerftPosT pos;
+      MoveInfoT moveInfo; // of the first occurrence
+      u32 multiplicity;   // number of move sequences reaching this position
+      u64 estimate;       // estimated subtree size for scheduling
+
+      ParaPerftItemT(const ParaPerftPosT& pos, const MoveInfoT moveInfo): pos(pos), moveInfo(moveInfo), multiplicity(1), estimate(0) {}
+    };
+
+    struct ParaPerftCollectorStateT {
+      std::vector<ParaPerftItemT>& items;
+      std::unordered_map<ZobristKeyT, u32>& itemNos; // by position key
+      std::vector<u32>& moveItemNos; // item number of each move sequence to the split depth in move generation order
+      const bool dedup;
+      const int splitDepth;
       const int depth;
 
-      Depth2CollectorStateT(std::list<std::pair<std::string, MoveInfoT>>& depth2FensAndMoves, const int depth) :
-	depth2FensAndMoves(depth2FensAndMoves), depth(depth) {}
+      ParaPerftCollectorStateT(std::vector<ParaPerftItemT>& items, std::unordered_map<ZobristKeyT, u32>& itemNos, std::vector<u32>& moveItemNos, const bool dedup, const int splitDepth, const int depth) :
+	items(items), itemNos(itemNos), moveItemNos(moveItemNos), dedup(dedup), splitDepth(splitDepth), depth(depth) {}
     };
     
     template <typename BoardT, ColorT Color>
-    struct Depth2CollectorPosHandlerT {
-      typedef Depth2CollectorPosHandlerT<BoardT, OtherColorT<Color>::value> ReverseT;
-      typedef Depth2CollectorPosHandlerT<typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
-      typedef Depth2CollectorPosHandlerT<typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
+    struct ParaPerftCollectorPosHandlerT {
+      typedef ParaPerftCollectorPosHandlerT<BoardT, OtherColorT<Color>::value> ReverseT;
+      typedef ParaPerftCollectorPosHandlerT<typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
+      typedef ParaPerftCollectorPosHandlerT<typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
       
-      inline static void handlePos(const Depth2CollectorStateT& state, const BoardT& board, MoveInfoT moveInfo) {
-	// This is a child node of the given depth and we're collecting depth-2 FEN's, hence when state.depth == 1
-	if(state.depth == 1) {
-	  state.depth2FensAndMoves.push_back(std::make_pair(Fen::toFenFast(board, Color, /*trimEp*/true), moveInfo));
+      inline static void handlePos(const ParaPerftCollectorStateT& state, const BoardT& board, MoveInfoT moveInfo) {
+	// This is a child node at depth state.depth+1
+	if(state.depth+1 == state.splitDepth) {
+	  const ParaPerftPosT pos = makeParaPerftPos(board, Color);
+	  auto it = state.dedup ? state.itemNos.find(pos.key) : state.itemNos.end();
+	  if(it == state.itemNos.end()) {
+	    const u32 itemNo = state.items.size();
+	    state.items.push_back(ParaPerftItemT(pos, moveInfo));
+	    if(state.dedup) {
+	      state.itemNos[pos.key] = itemNo;
+	    }
+	    state.moveItemNos.push_back(itemNo);
+	  } else {
+	    // Transposition
+	    state.items[it->second].multiplicity++;
+	    state.moveItemNos.push_back(it->second);
+	  }
+	} else {
+	  ParaPerftCollectorStateT newState(state.items, state.itemNos, state.moveItemNos, state.dedup, state.splitDepth, state.depth+1);
+	  MakeMove::makeAllLegalMoves<const ParaPerftCollectorStateT&, ParaPerftCollectorPosHandlerT<BoardT, Color>, BoardT, Color>(newState, board);
+	}
+      }
+    };
+
+    // Collect all unique positions at the split depth - leaf positions are not merged since their stats depend on the last move
+    template <typename BoardT, ColorT Color>
+    inline void collectParaPerftItems(const BoardT& board, const int splitDepth, const int depthToGo, std::vector<ParaPerftItemT>& items, std::vector<u32>& moveItemNos) {
+      items.clear();
+      moveItemNos.clear();
+      std::unordered_map<ZobristKeyT, u32> itemNos;
+      const ParaPerftCollectorStateT collectorState(items, itemNos, moveItemNos, /*dedup*/splitDepth < depthToGo, splitDepth, /*depth*/0);
+      MakeMove::makeAllLegalMoves<const ParaPerftCollectorStateT&, ParaPerftCollectorPosHandlerT<BoardT, Color>, BoardT, Color>(collectorState, board);
+    }
+
+    // Depth of the shallow nodes-only perft used to estimate item subtree sizes
+    const int ParaPerftEstimateDepth = 2;
+
+    inline u64 estimateParaPerftPos(const ParaPerftPosT& pos, const int depthToGo) {
+      const int depth = std::min(depthToGo, ParaPerftEstimateDepth);
+      if(pos.isFull) {
+	return pos.color == White ?
+	  perft<NodesOnlyStatsT, FullBoardT, White>(pos.fullBoard, depth, /*makeMoves*/false).nodes :
+	  perft<NodesOnlyStatsT, FullBoardT, Black>(pos.fullBoard, depth, /*makeMoves*/false).nodes;
+      } else {
+	return pos.color == White ?
+	  perft<NodesOnlyStatsT, BasicBoardT, White>(pos.basicBoard, depth, /*makeMoves*/false).nodes :
+	  perft<NodesOnlyStatsT, BasicBoardT, Black>(pos.basicBoard, depth, /*makeMoves*/false).nodes;
+      }
+    }
+
+    // Per-item result slot - tasks split off the same item may complete concurrently on different threads
+    struct ParaPerftItemStatsT {
+      std::atomic<u64> nodes;
+      std::atomic<u64> captures;
+      std::atomic<u64> eps;
+      std::atomic<u64> castles;
+      std::atomic<u64> promos;
+      std::atomic<u64> checks;
+      std::atomic<u64> discoverychecks;
+      std::atomic<u64> doublechecks;
+      std::atomic<u64> checkmates;
+      // Tasks for this item that are queued or running - the item is complete when this drops to zero
+      std::atomic<u32> nPendingTasks;
+
+      ParaPerftItemStatsT():
+	nodes(0), captures(0), eps(0), castles(0), promos(0), checks(0), discoverychecks(0), doublechecks(0), checkmates(0), nPendingTasks(0) {}
+
+      // Same fields as addAll()
+      void add(const PerftStatsT& stats) {
+	nodes.fetch_add(stats.nodes, std::memory_order_relaxed);
+	captures.fetch_add(stats.captures, std::memory_order_relaxed);
+	eps.fetch_add(stats.eps, std::memory_order_relaxed);
+	castles.fetch_add(stats.castles, std::memory_order_relaxed);
+	promos.fetch_add(stats.promos, std::memory_order_relaxed);
+	checks.fetch_add(stats.checks, std::memory_order_relaxed);
+	discoverychecks.fetch_add(stats.discoverychecks, std::memory_order_relaxed);
+	doublechecks.fetch_add(stats.doublechecks, std::memory_order_relaxed);
+	checkmates.fetch_add(stats.checkmates, std::memory_order_relaxed);
+      }
+
+      PerftStatsT get() const {
+	PerftStatsT stats = {};
+	stats.nodes = nodes.load(std::memory_order_relaxed);
+	stats.captures = captures.load(std::memory_order_relaxed);
+	stats.eps = eps.load(std::memory_order_relaxed);
+	stats.castles = castles.load(std::memory_order_relaxed);
+	stats.promos = promos.load(std::memory_order_relaxed);
+	stats.checks = checks.load(std::memory_order_relaxed);
+	stats.discoverychecks = discoverychecks.load(std::memory_order_relaxed);
+	stats.doublechecks = doublechecks.load(std::memory_order_relaxed);
+	stats.checkmates = checkmates.load(std::memory_order_relaxed);
+	return stats;
+      }
+    };
+
+    // A subtree to compute - the position after moveInfo at the given depth, accumulating into itemStats[itemNo]
+    struct ParaPerftTaskT {
+      ParaPerftPosT pos;
+      MoveInfoT moveInfo;
+      u32 itemNo;
+      u8 depth;
+      u8 depthToGo;
+
+      ParaPerftTaskT():
+	pos(), moveInfo(PushMove, NoPieceType, /*from*/InvalidSquare, /*to*/InvalidSquare, /*isDirectCheck*/false, /*isDiscoveredCheck*/false), itemNo(0), depth(0), depthToGo(0) {}
+
+      ParaPerftTaskT(const ParaPerftPosT& pos, const MoveInfoT moveInfo, const u32 itemNo, const int depth, const int depthToGo):
+	pos(pos), moveInfo(moveInfo), itemNo(itemNo), depth(depth), depthToGo(depthToGo) {}
+    };
+
+    using WorkStealingPool::WorkStealingPool;
+    typedef WorkStealingPool<ParaPerftTaskT> ParaPerftPoolT;
+
+    template <typename StatsT, typename TtT>
+    struct ParaPerftStateT {
+      PerftStatsT& stats;
+      ParaPerftPoolT& pool;
+      std::vector<ParaPerftItemStatsT>& itemStats;
+      TtT& tt;
+      std::vector<std::pair<u64, u64>>& ttStats; // (total-nodes, ht-hits) indexed by depth-to-go
+      bool& didSplit; // set if any subtree was pushed to the pool, in which case stats are only partial
+      const int threadNo;
+      const u32 itemNo;
+      const bool makeMoves;
+      const u8 maxTtDepth;
+      const u8 maxStealDepth;
+      const u8 depth;
+      const u8 depthToGo;
+
+      ParaPerftStateT(PerftStatsT& stats, ParaPerftPoolT& pool, std::vector<ParaPerftItemStatsT>& itemStats, TtT& tt, std::vector<std::pair<u64, u64>>& ttStats, bool& didSplit, const int threadNo, const u32 itemNo, const bool makeMoves, const u8 maxTtDepth, const u8 maxStealDepth, const u8 depth, const u8 depthToGo):
+	stats(stats), pool(pool), itemStats(itemStats), tt(tt), ttStats(ttStats), didSplit(didSplit), threadNo(threadNo), itemNo(itemNo), makeMoves(makeMoves), maxTtDepth(maxTtDepth), maxStealDepth(maxStealDepth), depth(depth), depthToGo(depthToGo) {}
+    };
+
+    template <typename StatsT, typename TtT, typename BoardT, ColorT Color>
+    struct ParaPerftPosHandlerT {
+      typedef ParaPerftPosHandlerT<StatsT, TtT, BoardT, OtherColorT<Color>::value> ReverseT;
+      typedef ParaPerftPosHandlerT<StatsT, TtT, typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
+      typedef ParaPerftPosHandlerT<StatsT, TtT, typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
+
+      // Compute the subtree locally - but keep looking for idle workers to hand child subtrees to
+      inline static void runPos(const ParaPerftStateT<StatsT, TtT>& state, const BoardT& board, const MoveInfoT moveInfo) {
+	// Too deep to be worth splitting - hand over to the regular TT perft
+	if(state.depth >= state.maxStealDepth || state.depthToGo <= 1) {
+	  const TtPerftStateT<StatsT, TtT> ttState(state.stats, state.tt, state.ttStats, /*doSplit*/false, state.makeMoves, state.maxTtDepth, state.depth, state.depthToGo);
+	  TtPerftPosHandlerT<StatsT, TtT, BoardT, Color>::handlePos(ttState, board, moveInfo);
+	  return;
+	}
+
+	PerftStatsT nodeStats = {};
+	
+	const bool useTt = MinTtDepth <= state.depth && state.depth <= state.maxTtDepth;
+	typename TtT::KeyT key = {};
+
+	if(useTt) {
+	  state.ttStats[state.depthToGo].first++;
+	  key = TtT::template genKey<BoardT, Color>(board, state.depthToGo);
+	  if(state.tt.copy_if_present(key, state.depthToGo, nodeStats)) {
+	    state.ttStats[state.depthToGo].second++;
+	    addAll(state.stats, nodeStats);
+	    return;
+	  }
+	}
+
+	bool childDidSplit = false;
+	const ParaPerftStateT<StatsT, TtT> newState(nodeStats, state.pool, state.itemStats, state.tt, state.ttStats, childDidSplit, state.threadNo, state.itemNo, state.makeMoves, state.maxTtDepth, state.maxStealDepth, state.depth+1, state.depthToGo-1);
+	MakeMove::makeAllLegalMoves<const ParaPerftStateT<StatsT, TtT>&, ParaPerftPosHandlerT<StatsT, TtT, BoardT, Color>, BoardT, Color, StatsT>(newState, board);
+
+	addAll(state.stats, nodeStats);
+
+	// Only complete subtrees go in the TT
+	if(childDidSplit) {
+	  state.didSplit = true;
+	} else if(useTt) {
+	  state.tt.put(key, state.depthToGo, nodeStats);
+	}
+      }
+      
+      inline static void handlePos(const ParaPerftStateT<StatsT, TtT>& state, const BoardT& board, MoveInfoT moveInfo) {
+	if(state.pool.has_idle()) {
+	  state.itemStats[state.itemNo].nPendingTasks.fetch_add(1, std::memory_order_relaxed);
+	  state.pool.push(state.threadNo, ParaPerftTaskT(makeParaPerftPos(board, Color), moveInfo, state.itemNo, state.depth, state.depthToGo));
+	  state.didSplit = true;
 	} else {
-	  Depth2CollectorStateT newState(state.depth2FensAndMoves, state.depth+1);
-	  MakeMove::makeAllLegalMoves<const Depth2CollectorStateT&, Depth2CollectorPosHandlerT<BoardT, Color>, BoardT, Color>(newState, board);
+	  runPos(state, board, moveInfo);
 	}
       }
     };
 
-    struct Depth2AccumulatorStateT {
+    template <typename StatsT, typename TtT>
+    inline void paraPerftWorkerFn(const int threadNo, ParaPerftPoolT& pool, const std::vector<ParaPerftItemT>& items, std::vector<ParaPerftItemStatsT>& itemStats, PerftJournalT* journal, TtT& tt, std::vector<std::pair<u64, u64>>& ttStats, const bool makeMoves, const int maxTtDepth, const int maxStealDepth, const int itemDepthToGo) {
+      u64 randState = 0x9e3779b97f4a7c15ULL * (u64)(threadNo + 1);
+      ParaPerftTaskT task;
+      
+      while(pool.get_task(threadNo, randState, task)) {
+	PerftStatsT stats = {};
+	bool didSplit = false;
+	const ParaPerftStateT<StatsT, TtT> state(stats, pool, itemStats, tt, ttStats, didSplit, threadNo, task.itemNo, makeMoves, maxTtDepth, maxStealDepth, task.depth, task.depthToGo);
+
+	const ParaPerftPosT& pos = task.pos;
+	if(pos.isFull) {
+	  if(pos.color == White) {
+	    ParaPerftPosHandlerT<StatsT, TtT, FullBoardT, White>::runPos(state, pos.fullBoard, task.moveInfo);
+	  } else {
+	    ParaPerftPosHandlerT<StatsT, TtT, FullBoardT, Black>::runPos(state, pos.fullBoard, task.moveInfo);
+	  }
+	} else {
+	  if(pos.color == White) {
+	    ParaPerftPosHandlerT<StatsT, TtT, BasicBoardT, White>::runPos(state, pos.basicBoard, task.moveInfo);
+	  } else {
+	    ParaPerftPosHandlerT<StatsT, TtT, BasicBoardT, Black>::runPos(state, pos.basicBoard, task.moveInfo);
+	  }
+	}
+
+	ParaPerftItemStatsT& thisItemStats = itemStats[task.itemNo];
+	thisItemStats.add(stats);
+
+	// Journal the item if that was its last task - leaf items aren't journalled since their stats depend on the last move
+	if(thisItemStats.nPendingTasks.fetch_sub(1, std::memory_order_acq_rel) == 1 && journal && itemDepthToGo > 0) {
+	  journal->append(items[task.itemNo].pos.key, itemDepthToGo, thisItemStats.get());
+	}
+	
+	pool.task_done();
+      }
+    }
+
+    template <typename StatsT>
+    struct ParaPerftAccumulatorStateT {
       PerftStatsT& stats;
-      const std::map<std::string, PerftStatsT>& depth2PosStats;
-      const bool doSplit;
+      const std::vector<ParaPerftItemStatsT>& itemStats;
+      const std::vector<u32>& moveItemNos;
+      size_t& nextMoveNo;
+      const int splitDepth;
       const int depth;
 
-      Depth2AccumulatorStateT(PerftStatsT& stats, const std::map<std::string, PerftStatsT>& depth2PosStats, const bool doSplit, const int depth) :
-	stats(stats), depth2PosStats(depth2PosStats), doSplit(doSplit), depth(depth) {}
+      ParaPerftAccumulatorStateT(PerftStatsT& stats, const std::vector<ParaPerftItemStatsT>& itemStats, const std::vector<u32>& moveItemNos, size_t& nextMoveNo, const int splitDepth, const int depth) :
+	stats(stats), itemStats(itemStats), moveItemNos(moveItemNos), nextMoveNo(nextMoveNo), splitDepth(splitDepth), depth(depth) {}
     };
     
-    template <typename BoardT, ColorT Color>
-    struct Depth2AccumulatorPosHandlerT {
-      typedef Depth2AccumulatorPosHandlerT<BoardT, OtherColorT<Color>::value> ReverseT;
-      typedef Depth2AccumulatorPosHandlerT<typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
-      typedef Depth2AccumulatorPosHandlerT<typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
+    template <typename StatsT, typename BoardT, ColorT Color>
+    struct ParaPerftAccumulatorPosHandlerT {
+      typedef ParaPerftAccumulatorPosHandlerT<StatsT, BoardT, OtherColorT<Color>::value> ReverseT;
+      typedef ParaPerftAccumulatorPosHandlerT<StatsT, typename BoardType<BoardT>::WithPromosT, Color> WithPromosT;
+      typedef ParaPerftAccumulatorPosHandlerT<StatsT, typename BoardType<BoardT>::WithoutPromosT, Color> WithoutPromosT;
       
-      inline static void handlePos(const Depth2AccumulatorStateT& state, const BoardT& board, MoveInfoT moveInfo) {
-	// This is a child node of the given depth and we're accumulating depth-2 stats, hence when state.depth == 1
-	if(state.depth == 1) {
-	  addAll(state.stats, state.depth2PosStats.at(Fen::toFenFast(board, Color, /*trimEp*/true)));
+      inline static void handlePos(const ParaPerftAccumulatorStateT<StatsT>& state, const BoardT& board, MoveInfoT moveInfo) {
+	// This is a child node at depth state.depth+1
+	PerftStatsT splitStats = {};
+	
+	// Moves are generated in the same order as when collecting, so the item is found by a running move count
+	if(state.depth+1 == state.splitDepth) {
+	  splitStats = state.itemStats[state.moveItemNos[state.nextMoveNo++]].get();
 	} else {
-	  PerftStatsT splitStats = {};
-	  Depth2AccumulatorStateT newState(splitStats, state.depth2PosStats, state.doSplit, state.depth+1);
-	  MakeMove::makeAllLegalMoves<const Depth2AccumulatorStateT&, Depth2AccumulatorPosHandlerT<BoardT, Color>, BoardT, Color>(newState, board);
-	  if(state.doSplit) {
-	    printf("  move %s-%s: ", SquareStr[moveInfo.from], SquareStr[moveInfo.to]);
-	    dumpStats(splitStats);
-	  }
-	  addAll(state.stats, splitStats);
+	  ParaPerftAccumulatorStateT<StatsT> newState(splitStats, state.itemStats, state.moveItemNos, state.nextMoveNo, state.splitDepth, state.depth+1);
+	  MakeMove::makeAllLegalMoves<const ParaPerftAccumulatorStateT<StatsT>&, ParaPerftAccumulatorPosHandlerT<StatsT, BoardT, Color>, BoardT, Color, StatsT>(newState, board);
+	}
+
+	if(state.depth == 0) {
+	  printSplitMove(moveInfo);
+	  dumpStats<StatsT>(splitStats);
 	}
+	
+	addAll(state.stats, splitStats);
       }
     };
 
-    inline void paraPerftWorkerFn(int n, std::mutex& m, std::list<std::pair<std::string, MoveInfoT>>& depth2FensAndMoves, std::map<std::string, PerftStatsT>& depth2PosStats, std::vector<std::vector<BoundedHashMap<std::string, PerftStatsT>>>& tts, std::vector<std::pair<u64, u64>>& ttStats, const bool makeMoves, const int maxTtDepth, const int depthToGo) {
-      int nFens = 0;
-      // Finish when the list is empty
-      while(true) {
-	// Get a depth-2 FEN to calculate
-	std::string fen;
-	MoveInfoT moveInfo(PushMove, NoPieceType, /*from*/InvalidSquare, /*to*/InvalidSquare, /*isDirectCheck*/false, /*isDiscoveredCheck*/false); // not used
-	{
-	  std::unique_lock<std::mutex> lock(m);
-	  if(depth2FensAndMoves.empty()) {
-	    return; // no more work
+    // Automatic split depth - the shallowest depth giving at least this many items per thread
+    const int ParaPerftAutoItemsPerThread = 8;
+    const int AutoSplitDepth = 0;
+
+    template <typename StatsT, typename TtT, typename BoardT, ColorT Color>
+    inline std::pair<PerftStatsT, std::vector<std::pair<u64, u64>>> paraPerft(const BoardT& board, const bool doSplit, const bool makeMoves, const int maxTtDepth, const int splitDepthArg, const int maxStealDepth, const int depthToGo, TtT& tt, const int nThreads, PerftJournalT* journal = 0) {
+      // Collect all unique positions at the split depth - deepening until there's enough work for all threads in auto mode
+      std::vector<ParaPerftItemT> items;
+      std::vector<u32> moveItemNos;
+      int splitDepth;
+      if(splitDepthArg == AutoSplitDepth) {
+	for(splitDepth = 1; ; splitDepth++) {
+	  collectParaPerftItems<BoardT, Color>(board, splitDepth, depthToGo, items, moveItemNos);
+	  if(items.size() >= (size_t)ParaPerftAutoItemsPerThread * nThreads || splitDepth+1 >= depthToGo || items.empty()) {
+	    break;
 	  }
-	  auto& fenAndMove = depth2FensAndMoves.front();
-	  fen = fenAndMove.first;
-	  moveInfo = fenAndMove.second;
-	  depth2FensAndMoves.pop_front();
-	  nFens++;
 	}
+      } else {
+	// Leaf items would be pointless - at least one level of perft per item, except for perft(1)
+	splitDepth = std::max(1, std::min(splitDepthArg, depthToGo-1));
+	collectParaPerftItems<BoardT, Color>(board, splitDepth, depthToGo, items, moveItemNos);
+      }
 
-	// Compute perft stats
-	auto boardAndColor = Fen::parseFen(fen);
-	const BasicBoardT& board = boardAndColor.first;
-	const ColorT colorToMove = boardAndColor.second;
-	
-	PerftStatsT stats = colorToMove == White ?
-	  ttPerft<BasicBoardT, White>(board, moveInfo, tts, ttStats, /*doSplit*/false, makeMoves, maxTtDepth, /*depth*/2, depthToGo-2) :
-	  ttPerft<BasicBoardT, Black>(board, moveInfo, tts, ttStats, /*doSplit*/false, makeMoves, maxTtDepth, /*depth*/2, depthToGo-2);
-
-	// Record the perft results
-	{
-	  std::unique_lock<std::mutex> lock(m);
-	  depth2PosStats[fen] = stats;
-	}
+      // Perft stats for each item
+      const size_t nItems = items.size();
+      std::vector<ParaPerftItemStatsT> itemStats(nItems);
+
+      // Largest first
+      std::vector<u32> itemOrder(nItems);
+      for(size_t i = 0; i < nItems; i++) {
+	items[i].estimate = estimateParaPerftPos(items[i].pos, depthToGo-splitDepth);
+	itemOrder[i] = i;
       }
-    }
+      std::stable_sort(itemOrder.begin(), itemOrder.end(), [&items](const u32 a, const u32 b) { return items[a].estimate > items[b].estimate; });
 
-    template <typename BoardT, ColorT Color>
-    inline std::pair<PerftStatsT, std::vector<std::pair<u64, u64>>> paraPerft(const BoardT& board, const bool doSplit, const bool makeMoves, const int maxTtDepth, const int depthToGo, const int ttSize, const int nTtParts, const int nThreads) {
-      // Collect all depth-2 positions - set of FEN's
-      std::list<std::pair<std::string, MoveInfoT>> depth2FensAndMoves;
-      const Depth2CollectorStateT depth2CollectorState(depth2FensAndMoves, /*depth*/0);
-      MakeMove::makeAllLegalMoves<const Depth2CollectorStateT&, Depth2CollectorPosHandlerT<BoardT, Color>, BoardT, Color>(depth2CollectorState, board);
-
-      // Perft stats for each depth-2 position
-      std::map<std::string, PerftStatsT> depth2PosStats;
-
-      // TT map: fen->stats for each depth
-      std::vector<std::vector<BoundedHashMap<std::string, PerftStatsT>>> tts(nTtParts);
-      for(int partNo = 0; partNo < nTtParts; partNo++) {
-	for(int i = MinTtDepth; i <= maxTtDepth; i++) {
-	  tts[partNo].push_back(BoundedHashMap<std::string, PerftStatsT>(ttSize));
+      // Deal the items out round-robin - in reverse since workers pop from the back of their own deque
+      // Items that are already in the journal we're resuming are done.
+      const int itemDepthToGo = depthToGo - splitDepth;
+      ParaPerftPoolT pool(nThreads);
+      size_t nResumed = 0;
+      for(size_t i = nItems, nPushed = 0; i-- > 0; ) {
+	const u32 itemNo = itemOrder[i];
+	PerftStatsT resumedStats = {};
+	if(journal && itemDepthToGo > 0 && journal->lookup(items[itemNo].pos.key, itemDepthToGo, resumedStats)) {
+	  itemStats[itemNo].add(resumedStats);
+	  nResumed++;
+	} else {
+	  itemStats[itemNo].nPendingTasks.store(1, std::memory_order_relaxed);
+	  pool.push(nPushed++ % nThreads, ParaPerftTaskT(items[itemNo].pos, items[itemNo].moveInfo, itemNo, splitDepth, itemDepthToGo));
 	}
       }
+      if(journal && journal->isResumed()) {
+	printf("  resumed %lu of %lu items from the journal\n\n", nResumed, nItems);
+      }
+
       // TT usage stats - for each thread
       std::vector<std::vector<std::pair<u64, u64>>> threadTtStats(nThreads);
       for(int i = 0; i < nThreads; i++) {
-	threadTtStats[i] = std::vector<std::pair<u64, u64>>(maxTtDepth == 0 ? 0 : (maxTtDepth-MinTtDepth+1));
+	threadTtStats[i] = std::vector<std::pair<u64, u64>>(depthToGo+1);
       }
       
-      // Mutex to lock all accesses to input list of depth2FensAndMoves and output map 
-      std::mutex workerMutex;
-      // Run worker threads to process the depth-2 positions in parallel
+      // Run worker threads to process the items in parallel
       std::vector<std::thread> workers;
       for(int i = 0; i < nThreads; i++) {
-	workers.push_back(std::thread(paraPerftWorkerFn, i, std::ref(workerMutex), std::ref(depth2FensAndMoves), std::ref(depth2PosStats), std::ref(tts), std::ref(threadTtStats[i]), makeMoves, maxTtDepth, depthToGo)); 
+	workers.push_back(std::thread(paraPerftWorkerFn<StatsT, TtT>, i, std::ref(pool), std::cref(items), std::ref(itemStats), journal, std::ref(tt), std::ref(threadTtStats[i]), makeMoves, maxTtDepth, maxStealDepth, itemDepthToGo)); 
       }
       for(int i = 0; i < nThreads; i++) {
 	workers[i].join();
       }
 
       PerftStatsT stats = {};
-      Depth2AccumulatorStateT depth2AccumulatorState(stats, depth2PosStats, doSplit, /*depth*/0);
-      MakeMove::makeAllLegalMoves<const Depth2AccumulatorStateT&, Depth2AccumulatorPosHandlerT<BoardT, Color>, BoardT, Color>(depth2AccumulatorState, board);
+      if(doSplit) {
+	size_t nextMoveNo = 0;
+	ParaPerftAccumulatorStateT<StatsT> accumulatorState(stats, itemStats, moveItemNos, nextMoveNo, splitDepth, /*depth*/0);
+	MakeMove::makeAllLegalMoves<const ParaPerftAccumulatorStateT<StatsT>&, ParaPerftAccumulatorPosHandlerT<StatsT, BoardT, Color>, BoardT, Color, StatsT>(accumulatorState, board);
+      } else {
+	for(size_t i = 0; i < nItems; i++) {
+	  const PerftStatsT thisItemStats = itemStats[i].get();
+	  for(u32 n = 0; n < items[i].multiplicity; n++) {
+	    addAll(stats, thisItemStats);
+	  }
+	}
+      }
 
       // Accumulate the stats from all threads
-      std::vector<std::pair<u64, u64>> ttStats(maxTtDepth == 0 ? 0 : (maxTtDepth-MinTtDepth+1));
+      std::vector<std::pair<u64, u64>> ttStats(depthToGo+1);
       for(int threadNo = 0; threadNo < nThreads; threadNo++) {
 	for(size_t i = 0; i < threadTtStats[threadNo].size(); i++) {
 	  ttStats[i].first += threadTtStats[threadNo][i].first;
@@ -0,0 +1,134 @@
+#ifndef SLIDER_FILL_HPP
+#define SLIDER_FILL_HPP
+
+// Set-wise slider attacks - all 8 ray directions for all of a side's sliders at once
+//
+// This is Kogge-Stone occluded fill: each direction floods the slider set along empty squares in 3 doubling
+//   steps (1, 2, 4 squares), then shifts one more step to include the blocker. Unlike table lookup there is
+//   no per-piece work, so it suits the places where we only want the union of a side's attacks.
+// The 8 directions are independent, so they vectorise nicely:
+//   - AVX-512 - all 8 directions in one zmm register; a 64-bit lane rotate does both left and right shifts
+//     as long as the wrap masks also exclude the first rank in the direction of travel.
+//   - AVX2 - the 4 left-shifting and 4 right-shifting directions in one ymm register each.
+//   - otherwise plain scalar code.
+
+#include "types.hpp"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace Chess {
+
+  namespace SliderFill {
+
+    // Fill masks - the squares a step in the given direction can land on.
+    // For the rotate-based AVX-512 kernel these must also exclude the squares that wrapped bits land on -
+    //   for east and west the file mask already does, the others can never land on the first rank anyway.
+    const BitBoardT NorthMask = ~Rank1;
+    const BitBoardT EastMask = ~FileA;
+    const BitBoardT NorthEastMask = ~FileA & ~Rank1;
+    const BitBoardT NorthWestMask = ~FileH & ~Rank1;
+    const BitBoardT SouthMask = ~Rank8;
+    const BitBoardT WestMask = ~FileH;
+    const BitBoardT SouthWestMask = ~FileH & ~Rank8;
+    const BitBoardT SouthEastMask = ~FileA & ~Rank8;
+
+#if defined(__AVX512F__)
+
+    // Lanes are N, E, NE, NW, S, W, SW, SE - the right-shifting directions rotate left by 64 - shift.
+    inline BitBoardT allSliderAttacksBb(const BitBoardT diagSlidersBb, const BitBoardT orthogSlidersBb, const BitBoardT allPiecesBb) {
+      const __m512i rotates = _mm512_setr_epi64(8, 1, 9, 7, 64-8, 64-1, 64-9, 64-7);
+      const __m512i rotates2 = _mm512_setr_epi64(16, 2, 18, 14, 64-16, 64-2, 64-18, 64-14);
+      const __m512i rotates4 = _mm512_setr_epi64(32, 4, 36, 28, 64-32, 64-4, 64-36, 64-28);
+      const __m512i masks = _mm512_setr_epi64(NorthMask, EastMask, NorthEastMask, NorthWestMask, SouthMask, WestMask, SouthWestMask, SouthEastMask);
+
+      __m512i gen = _mm512_setr_epi64(orthogSlidersBb, orthogSlidersBb, diagSlidersBb, diagSlidersBb, orthogSlidersBb, orthogSlidersBb, diagSlidersBb, diagSlidersBb);
+      __m512i pro = _mm512_and_si512(_mm512_set1_epi64(~allPiecesBb), masks);
+
+      gen = _mm512_or_si512(gen, _mm512_and_si512(pro, _mm512_rolv_epi64(gen, rotates)));
+      pro = _mm512_and_si512(pro, _mm512_rolv_epi64(pro, rotates));
+      gen = _mm512_or_si512(gen, _mm512_and_si512(pro, _mm512_rolv_epi64(gen, rotates2)));
+      pro = _mm512_and_si512(pro, _mm512_rolv_epi64(pro, rotates2));
+      gen = _mm512_or_si512(gen, _mm512_and_si512(pro, _mm512_rolv_epi64(gen, rotates4)));
+
+      const __m512i attacks = _mm512_and_si512(_mm512_rolv_epi64(gen, rotates), masks);
+
+      return (BitBoardT)_mm512_reduce_or_epi64(attacks);
+    }
+
+#elif defined(__AVX2__)
+
+    // Lanes are N, E, NE, NW for the left-shifting half and S, W, SW, SE for the right-shifting half.
+    inline __m256i fillHalf(__m256i gen, __m256i pro, const __m256i shifts, const __m256i masks, const bool isLeft) {
+      const __m256i shifts2 = _mm256_add_epi64(shifts, shifts);
+      const __m256i shifts4 = _mm256_add_epi64(shifts2, shifts2);
+      pro = _mm256_and_si256(pro, masks);
+      if(isLeft) {
+	gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, shifts)));
+	pro = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, shifts));
+	gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, shifts2)));
+	pro = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, shifts2));
+	gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, shifts4)));
+	return _mm256_and_si256(_mm256_sllv_epi64(gen, shifts), masks);
+      } else {
+	gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, shifts)));
+	pro = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, shifts));
+	gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, shifts2)));
+	pro = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, shifts2));
+	gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, shifts4)));
+	return _mm256_and_si256(_mm256_srlv_epi64(gen, shifts), masks);
+      }
+    }
+
+    inline BitBoardT allSliderAttacksBb(const BitBoardT diagSlidersBb, const BitBoardT orthogSlidersBb, const BitBoardT allPiecesBb) {
+      const __m256i shifts = _mm256_setr_epi64x(8, 1, 9, 7);
+      const __m256i gen = _mm256_setr_epi64x(orthogSlidersBb, orthogSlidersBb, diagSlidersBb, diagSlidersBb);
+      const __m256i pro = _mm256_set1_epi64x(~allPiecesBb);
+
+      const __m256i leftAttacks = fillHalf(gen, pro, shifts, _mm256_setr_epi64x(NorthMask, EastMask, NorthEastMask, NorthWestMask), /*isLeft*/true);
+      const __m256i rightAttacks = fillHalf(gen, pro, shifts, _mm256_setr_epi64x(SouthMask, WestMask, SouthWestMask, SouthEastMask), /*isLeft*/false);
+
+      const __m256i attacks4 = _mm256_or_si256(leftAttacks, rightAttacks);
+      const __m128i attacks2 = _mm_or_si128(_mm256_castsi256_si128(attacks4), _mm256_extracti128_si256(attacks4, 1));
+      return (BitBoardT)(_mm_cvtsi128_si64(attacks2) | _mm_extract_epi64(attacks2, 1));
+    }
+
+#else
+
+    template <int Shift>
+    inline BitBoardT shiftBb(const BitBoardT bb) {
+      return Shift > 0 ? bb << Shift : bb >> -Shift;
+    }
+
+    template <int Shift>
+    inline BitBoardT fillAttacksBb(BitBoardT gen, BitBoardT pro, const BitBoardT mask) {
+      pro &= mask;
+      gen |= pro & shiftBb<Shift>(gen);
+      pro &= shiftBb<Shift>(pro);
+      gen |= pro & shiftBb<2*Shift>(gen);
+      pro &= shiftBb<2*Shift>(pro);
+      gen |= pro & shiftBb<4*Shift>(gen);
+      return shiftBb<Shift>(gen) & mask;
+    }
+
+    inline BitBoardT allSliderAttacksBb(const BitBoardT diagSlidersBb, const BitBoardT orthogSlidersBb, const BitBoardT allPiecesBb) {
+      const BitBoardT emptyBb = ~allPiecesBb;
+      return
+	fillAttacksBb<8>(orthogSlidersBb, emptyBb, NorthMask) |
+	fillAttacksBb<1>(orthogSlidersBb, emptyBb, EastMask) |
+	fillAttacksBb<-8>(orthogSlidersBb, emptyBb, SouthMask) |
+	fillAttacksBb<-1>(orthogSlidersBb, emptyBb, WestMask) |
+	fillAttacksBb<9>(diagSlidersBb, emptyBb, NorthEastMask) |
+	fillAttacksBb<7>(diagSlidersBb, emptyBb, NorthWestMask) |
+	fillAttacksBb<-9>(diagSlidersBb, emptyBb, SouthWestMask) |
+	fillAttacksBb<-7>(diagSlidersBb, emptyBb, SouthEastMask);
+    }
+
+#endif
+
+  } // namespace SliderFill
+
+} // namespace Chess
+
+#endif //ndef SLIDER_FILL_HPP
@@ -0,0 +1,170 @@
+#include "cstdio"
+#include "cstdlib"
+#include "cstring"
+#include "vector"
+
+#include "types.hpp"
+#include "bits.hpp"
+
+using namespace Chess;
+
+// Search for rook and bishop magic multipliers and emit them as src/magic-bbs.hpp
+//
+// For each square we first try to find a magic with fewer index bits than there are blocker bits - such magics
+//   rely on constructive collisions (different blockers, same attacks) and make the packed attack table denser.
+//   If none turns up within the trial budget we fall back to the full number of index bits, which always succeeds.
+//
+// g++ -std=c++11 -O3 -march=native -I ../ -o find-magics find-magics.cpp
+// ./find-magics [dense-trials [seed]] > ../magic-bbs.hpp
+
+static u64 randState = 0x6d616769632d6262ULL;
+
+// xorshift64
+static u64 rand64() {
+  randState ^= randState << 13;
+  randState ^= randState >> 7;
+  randState ^= randState << 17;
+  return randState;
+}
+
+// Sparse randoms make much better magic candidates
+static u64 sparseRand64() {
+  return rand64() & rand64() & rand64();
+}
+
+static const int RookDirs[4][2] = { {0, 1}, {0, -1}, {1, 0}, {-1, 0} };
+static const int BishopDirs[4][2] = { {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+
+static BitBoardT slowAttacks(const int square, const BitBoardT blockers, const int dirs[4][2]) {
+  BitBoardT attacks = 0;
+  for(int d = 0; d < 4; d++) {
+    int file = square % 8 + dirs[d][0], rank = square / 8 + dirs[d][1];
+    for(; 0 <= file && file < 8 && 0 <= rank && rank < 8; file += dirs[d][0], rank += dirs[d][1]) {
+      const BitBoardT bb = (BitBoardT)1 << (rank*8 + file);
+      attacks |= bb;
+      if(blockers & bb) {
+	break;
+      }
+    }
+  }
+  return attacks;
+}
+
+// Attacks on an empty board less the last square on each ray, which never blocks anything
+static BitBoardT blockersMask(const int square, const int dirs[4][2]) {
+  BitBoardT mask = 0;
+  for(int d = 0; d < 4; d++) {
+    int file = square % 8 + dirs[d][0], rank = square / 8 + dirs[d][1];
+    for(; 0 <= file + dirs[d][0] && file + dirs[d][0] < 8 && 0 <= rank + dirs[d][1] && rank + dirs[d][1] < 8; file += dirs[d][0], rank += dirs[d][1]) {
+      mask |= (BitBoardT)1 << (rank*8 + file);
+    }
+  }
+  return mask;
+}
+
+static BitBoardT blockersForIndex(const int index, BitBoardT mask) {
+  BitBoardT blockers = 0;
+  int nBits = Bits::count(mask);
+  for (int i = 0; i < nBits; i++) {
+    SquareT square = Bits::popLsb(mask);
+    if(index & (1 << i)) {
+      blockers |= bbForSquare(square);
+    }
+  }
+  return blockers;
+}
+
+// Returns a magic multiplier for the given number of index bits, or 0 if none found within nTrials
+static u64 findMagic(const int square, const int dirs[4][2], const int indexBits, const long nTrials) {
+  const BitBoardT mask = blockersMask(square, dirs);
+  const int nBlockerIndexes = 1 << Bits::count(mask);
+
+  std::vector<BitBoardT> blockers(nBlockerIndexes), attacks(nBlockerIndexes);
+  for(int i = 0; i < nBlockerIndexes; i++) {
+    blockers[i] = blockersForIndex(i, mask);
+    attacks[i] = slowAttacks(square, blockers[i], dirs);
+  }
+
+  std::vector<BitBoardT> table(1 << indexBits);
+  std::vector<int> tableEpoch(1 << indexBits, -1);
+
+  for(long trial = 0; trial < nTrials; trial++) {
+    const u64 magic = sparseRand64();
+    // Quick reject - the top byte of the product has to be reasonably well populated
+    if(Bits::count((mask * magic) & 0xFF00000000000000ULL) < 6) {
+      continue;
+    }
+
+    bool ok = true;
+    for(int i = 0; ok && i < nBlockerIndexes; i++) {
+      const size_t index = (blockers[i] * magic) >> (64 - indexBits);
+      if(tableEpoch[index] != trial) {
+	tableEpoch[index] = (int)trial;
+	table[index] = attacks[i];
+      } else if(table[index] != attacks[i]) {
+	ok = false;
+      }
+    }
+    if(ok) {
+      return magic;
+    }
+  }
+  return 0;
+}
+
+static void findMagics(const char* name, const int dirs[4][2], const long nDenseTrials, u64 magics[64], int bits[64]) {
+  for(int square = 0; square < 64; square++) {
+    const int maskBits = Bits::count(blockersMask(square, dirs));
+    bits[square] = maskBits - 1;
+    magics[square] = findMagic(square, dirs, bits[square], nDenseTrials);
+    if(magics[square] == 0) {
+      bits[square] = maskBits;
+      // Long enough in practice - rook corners are the slowest
+      magics[square] = findMagic(square, dirs, bits[square], 1L << 31);
+    }
+    if(magics[square] == 0) {
+      fprintf(stderr, "Failed to find %s magic for square %d\n", name, square);
+      exit(1);
+    }
+    fprintf(stderr, "%s square %2d: %2d bits (mask has %2d)\n", name, square, bits[square], maskBits);
+  }
+}
+
+static void printMagics(const char* name, const u64 magics[64], const int bits[64]) {
+  printf("    const BitBoardT %sMagicBbMultipliers[64+1] = {\n", name);
+  for(int square = 0; square < 64; square++) {
+    printf("%s0x%016lxull,%s", (square % 4 == 0 ? "      " : ""), magics[square], ((square+1) % 4 == 0 ? "\n" : " "));
+  }
+  printf("      0x0, // InvalidSquare\n    };\n\n");
+
+  size_t tableSize = 0;
+  printf("    const u8 %sMagicBbIndexBits[64+1] = {\n", name);
+  for(int square = 0; square < 64; square++) {
+    printf("%s%2d,%s", (square % 8 == 0 ? "      " : ""), bits[square], ((square+1) % 8 == 0 ? "\n" : " "));
+    tableSize += (size_t)1 << bits[square];
+  }
+  printf("      0 // InvalidSquare\n    };\n\n");
+
+  printf("    // Sum of 2^%sMagicBbIndexBits plus one entry for InvalidSquare\n", name);
+  printf("    const size_t %sMagicBbTableSize = %lu + 1;\n\n", name, tableSize);
+}
+
+int main(int argc, char* argv[]) {
+  const long nDenseTrials = argc > 1 ? atol(argv[1]) : 1000000;
+  if(argc > 2) {
+    randState = strtoull(argv[2], 0, 0);
+  }
+
+  u64 rookMagics[64], bishopMagics[64];
+  int rookBits[64], bishopBits[64];
+  findMagics("Rook", RookDirs, nDenseTrials, rookMagics, rookBits);
+  findMagics("Bishop", BishopDirs, nDenseTrials, bishopMagics, bishopBits);
+
+  printf("#ifndef MAGIC_BBS_HPP\n#define MAGIC_BBS_HPP\n\n");
+  printf("// Generated by src/tools/find-magics.cpp - do not edit\n\n");
+  printf("#include \"types.hpp\"\n\n");
+  printf("namespace Chess {\n\n  namespace MoveGen {\n\n");
+  printMagics("Rook", rookMagics, rookBits);
+  printMagics("Bishop", bishopMagics, bishopBits);
+  printf("  } // namespace MoveGen\n\n} // namespace Chess\n\n#endif //ndef MAGIC_BBS_HPP\n");
+}
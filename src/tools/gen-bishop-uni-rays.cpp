@@ -6,7 +6,7 @@
 using namespace Chess;
 using namespace MoveGen;
 
-// g++ -I ../ -o gen-bishop-uni-rays gen-bishop-uni-rays.cpp ../move-gen.cpp
+// g++ -std=c++11 -march=native -I ../ -o gen-bishop-uni-rays gen-bishop-uni-rays.cpp ../../obj/slider-tables.cpp
 
 int main() {
   // Bishop uni-rays
@@ -0,0 +1,269 @@
+#include "cstdio"
+#include "cstdlib"
+
+#include "types.hpp"
+#include "bits.hpp"
+#include "move-gen.hpp"
+
+using namespace Chess;
+using namespace MoveGen;
+
+// Generate Rays, BetweenBb/LineBb and the slider attack tables for the selected SLIDERS backend as const data.
+//
+// The Makefile builds this with the same flags as everything else, and compiles its output as obj/slider-tables.cpp,
+//   so the tables land in read-only sections of the binary - no static initialisation at startup, and the pages
+//   are shared between processes through the page cache.
+//
+// ./gen-slider-tables > slider-tables.cpp
+
+static BitBoardT rays[8][64+1];
+
+static void initRays() {
+  for(SquareT square = A1; square <= H8; square++) {
+    // North
+    rays[N][square] = 0x0101010101010100ULL << square;
+
+    // South
+    rays[S][square] = 0x0080808080808080ULL >> (63 - square);
+
+    // East
+    rays[E][square] = 2 * (bbForSquare(square | 7) - bbForSquare(square));
+
+    // West
+    rays[W][square] = bbForSquare(square) - bbForSquare(square & 56);
+
+    // North West
+    rays[NW][square] = Bits::westNTimes(0x102040810204000ULL, 7 - fileOf(square)) << (rankOf(square) * 8);
+
+    // North East
+    rays[NE][square] = Bits::eastNTimes(0x8040201008040200ULL, fileOf(square)) << (rankOf(square) * 8);
+
+    // South West
+    rays[SW][square] = Bits::westNTimes(0x40201008040201ULL, 7 - fileOf(square)) >> ((7 - rankOf(square)) * 8);
+
+    // South East
+    rays[SE][square] = Bits::eastNTimes(0x2040810204080ULL, fileOf(square)) >> ((7 - rankOf(square)) * 8);
+  }
+}
+
+static void printBbs(const BitBoardT* bbs, const size_t n) {
+  for(size_t i = 0; i < n; i++) {
+    printf("%s0x%016lxull,%s", (i % 4 == 0 ? "      " : ""), bbs[i], ((i+1) % 4 == 0 || i+1 == n ? "\n" : " "));
+  }
+}
+
+static void printRays() {
+  printf("    const BitBoardT Rays[8][64+1] = {\n");
+  for(int dir = 0; dir < 8; dir++) {
+    printf("      {\n");
+    printBbs(rays[dir], 64+1);
+    printf("      },\n");
+  }
+  printf("    };\n\n");
+}
+
+static const DirT OppositeDirs[8] = { S, N, W, E, SW, SE, NW, NE };
+
+// Squares strictly between two squares on a common line, and the whole line through them - BbNone if they don't share a line
+static void printBetweenAndLineBbs() {
+  static BitBoardT betweenBbs[64][64], lineBbs[64][64];
+  for(SquareT from = A1; from <= H8; from++) {
+    for(SquareT to = A1; to <= H8; to++) {
+      for(int dir = 0; dir < 8; dir++) {
+	if((rays[dir][from] & bbForSquare(to)) != BbNone) {
+	  betweenBbs[from][to] = rays[dir][from] & ~rays[dir][to] & ~bbForSquare(to);
+	  lineBbs[from][to] = rays[dir][from] | rays[OppositeDirs[dir]][from] | bbForSquare(from);
+	}
+      }
+    }
+  }
+
+  printf("    const BitBoardT BetweenBb[64][64] = {\n");
+  for(SquareT from = A1; from <= H8; from++) {
+    printf("      {\n");
+    printBbs(betweenBbs[from], 64);
+    printf("      },\n");
+  }
+  printf("    };\n\n");
+
+  printf("    const BitBoardT LineBb[64][64] = {\n");
+  for(SquareT from = A1; from <= H8; from++) {
+    printf("      {\n");
+    printBbs(lineBbs[from], 64);
+    printf("      },\n");
+  }
+  printf("    };\n\n");
+}
+
+#if SLIDERS != SLIDERS_TABLELESS
+
+static BitBoardT blockersForIndex(const int index, BitBoardT mask) {
+  BitBoardT blockers = 0;
+  int nBits = Bits::count(mask);
+  for (int i = 0; i < nBits; i++) {
+    SquareT square = Bits::popLsb(mask);
+    if(index & (1 << i)) {
+      blockers |= bbForSquare(square);
+    }
+  }
+  return blockers;
+}
+
+static BitBoardT rookAttacksSlow(const int square, const BitBoardT blockers) {
+  BitBoardT attacks = 0;
+
+  // North
+  attacks |= rays[N][square];
+  if(rays[N][square] & blockers) {
+    attacks &= ~rays[N][Bits::lsb(rays[N][square] & blockers)];
+  }
+
+  // South
+  attacks |= rays[S][square];
+  if(rays[S][square] & blockers) {
+    attacks &= ~rays[S][Bits::msb(rays[S][square] & blockers)];
+  }
+
+  // East
+  attacks |= rays[E][square];
+  if(rays[E][square] & blockers) {
+    attacks &= ~rays[E][Bits::lsb(rays[E][square] & blockers)];
+  }
+
+  // West
+  attacks |= rays[W][square];
+  if(rays[W][square] & blockers) {
+    attacks &= ~rays[W][Bits::msb(rays[W][square] & blockers)];
+  }
+
+  return attacks;
+}
+
+static BitBoardT bishopAttacksSlow(const int square, const BitBoardT blockers) {
+  BitBoardT attacks = 0;
+
+  // North West
+  attacks |= rays[NW][square];
+  if(rays[NW][square] & blockers) {
+    attacks &= ~rays[NW][Bits::lsb(rays[NW][square] & blockers)];
+  }
+
+  // North East
+  attacks |= rays[NE][square];
+  if(rays[NE][square] & blockers) {
+    attacks &= ~rays[NE][Bits::lsb(rays[NE][square] & blockers)];
+  }
+
+  // South East
+  attacks |= rays[SE][square];
+  if(rays[SE][square] & blockers) {
+    attacks &= ~rays[SE][Bits::msb(rays[SE][square] & blockers)];
+  }
+
+  // South West
+  attacks |= rays[SW][square];
+  if(rays[SW][square] & blockers) {
+    attacks &= ~rays[SW][Bits::msb(rays[SW][square] & blockers)];
+  }
+
+  return attacks;
+}
+
+#endif // !SLIDERS_TABLELESS
+
+#if SLIDERS == SLIDERS_MAGIC
+
+static void printMagicBbTable(const char* name, const size_t tableSize, const BitBoardT blockerMasks[64+1], const BitBoardT multipliers[64+1], const u8 indexBits[64+1], BitBoardT (*attacksSlow)(const int, const BitBoardT)) {
+  BitBoardT* table = new BitBoardT[tableSize]();
+  size_t offsets[64+1];
+
+  size_t offset = 0;
+  for(SquareT square = A1; square <= H8; square++) {
+    offsets[square] = offset;
+    // For all possible blockers for this square
+    for(int blockerIndex = 0; blockerIndex < (1 << Bits::count(blockerMasks[square])); blockerIndex++) {
+      BitBoardT blockers = blockersForIndex(blockerIndex, blockerMasks[square]);
+      table[offset + ((blockers * multipliers[square]) >> (64 - indexBits[square]))] = attacksSlow(square, blockers);
+    }
+    offset += (size_t)1 << indexBits[square];
+  }
+  // InvalidSquare (non-)moves - the table entry is BbNone already
+  offsets[InvalidSquare] = offset;
+  if(offset + 1 != tableSize) {
+    fprintf(stderr, "Magic BB slider table size mismatch - expected %lu, got %lu\n", tableSize, offset + 1);
+    exit(1);
+  }
+
+  printf("    const BitBoardT %sMagicBbTable[%sMagicBbTableSize] = {\n", name, name);
+  printBbs(table, tableSize);
+  printf("    };\n\n");
+
+  printf("    const MagicBbT %sMagicBbs[64+1] = {\n", name);
+  for(SquareT square = A1; square <= H8; square++) {
+    printf("      { 0x%016lxull, 0x%016lxull, &%sMagicBbTable[%lu], %d },\n", blockerMasks[square], multipliers[square], name, offsets[square], 64 - indexBits[square]);
+  }
+  // InvalidSquare - the mask is empty so the index is always 0 - and avoid an (undefined) shift by 64
+  printf("      { BbNone, 0, &%sMagicBbTable[%lu], 63 }, // InvalidSquare\n", name, offsets[InvalidSquare]);
+  printf("    };\n\n");
+
+  delete[] table;
+}
+
+#elif SLIDERS == SLIDERS_PEXT
+
+// PEXT of the blockers gives exactly the blocker index used by blockersForIndex()
+static void printPextBbTable(const char* name, const size_t tableSize, const BitBoardT blockerMasks[64+1], BitBoardT (*attacksSlow)(const int, const BitBoardT)) {
+  BitBoardT* table = new BitBoardT[tableSize]();
+  u32 offsets[64+1];
+
+  u32 offset = 0;
+  for(SquareT square = A1; square <= H8; square++) {
+    offsets[square] = offset;
+    const int nBlockerIndexes = 1 << Bits::count(blockerMasks[square]);
+    for(int blockerIndex = 0; blockerIndex < nBlockerIndexes; blockerIndex++) {
+      table[offset + blockerIndex] = attacksSlow(square, blockersForIndex(blockerIndex, blockerMasks[square]));
+    }
+    offset += nBlockerIndexes;
+  }
+  // InvalidSquare (non-)moves - the blocker mask is empty so the index is always 0 - and the table entry is BbNone already
+  offsets[InvalidSquare] = offset;
+  if(offset + 1 != tableSize) {
+    fprintf(stderr, "PEXT slider table size mismatch - expected %lu, got %u\n", tableSize, offset + 1);
+    exit(1);
+  }
+
+  printf("    const u32 %sPextBbOffsets[64+1] = {\n", name);
+  for(int square = 0; square < 64+1; square++) {
+    printf("%s%u,%s", (square % 8 == 0 ? "      " : ""), offsets[square], ((square+1) % 8 == 0 || square == 64 ? "\n" : " "));
+  }
+  printf("    };\n\n");
+
+  printf("    const BitBoardT %sPextBbTable[%sPextBbTableSize] = {\n", name, name);
+  printBbs(table, tableSize);
+  printf("    };\n\n");
+
+  delete[] table;
+}
+
+#endif
+
+int main() {
+  initRays();
+
+  printf("// Generated by src/tools/gen-slider-tables.cpp - do not edit\n\n");
+  printf("#include \"move-gen.hpp\"\n\n");
+  printf("namespace Chess {\n\n  namespace MoveGen {\n\n");
+
+  printRays();
+  printBetweenAndLineBbs();
+
+#if SLIDERS == SLIDERS_MAGIC
+  printMagicBbTable("Rook", RookMagicBbTableSize, RookBlockers, RookMagicBbMultipliers, RookMagicBbIndexBits, rookAttacksSlow);
+  printMagicBbTable("Bishop", BishopMagicBbTableSize, BishopBlockers, BishopMagicBbMultipliers, BishopMagicBbIndexBits, bishopAttacksSlow);
+#elif SLIDERS == SLIDERS_PEXT
+  printPextBbTable("Rook", RookPextBbTableSize, RookBlockers, rookAttacksSlow);
+  printPextBbTable("Bishop", BishopPextBbTableSize, BishopBlockers, bishopAttacksSlow);
+#endif
+
+  printf("  } // namespace MoveGen\n\n} // namespace Chess\n");
+}
@@ -8,6 +8,7 @@ using std::size_t;
 
 typedef uint8_t u8;
 typedef uint16_t u16;
+typedef uint32_t u32;
 typedef uint64_t u64;
 
 namespace Chess {
@@ -268,25 +269,45 @@ namespace Chess {
     CastlingMove
   };
 
+  // Move info handed to pos handlers - packed into a single 32-bit word:
+  //
+  //   bits  0-5   from square - for castling this is the king 'from' square
+  //   bits  6-11  to square - for castling this is the king 'to' square
+  //   bits 12-13  MoveTypeT
+  //   bits 14-16  PieceTypeT - for promos, this is the promo piece
+  //   bit  17     is pawn promotion
+  //   bit  18     the moved piece delivers check from the 'to' square
+  //   bit  19     the moved piece uncovers discovered check
+  //
+  // Squares only have 6 bits so InvalidSquare (used for the dummy root move) reads back as A1.
   struct MoveInfoT {
-    MoveTypeT moveType;
-    // For promos, this is the promo piece
-    PieceTypeT pieceType;
-    // For castling this is the king 'from' square.
-    SquareT from;
-    // For castling this is the king 'to' square;
-    SquareT to;
-    // True iff the moved piece delivers check from the 'to' square.
-    bool isDirectCheck;
-    // True iff the moved piece uncovers discovered check.
-    bool isDiscoveredCheck;
-    // True iff this is a pawn promotion
-    bool isPromo;
+    static const int FromShift = 0;
+    static const int ToShift = 6;
+    static const int MoveTypeShift = 12;
+    static const int PieceTypeShift = 14;
+    static const u32 IsPromoBit = (u32)1 << 17;
+    static const u32 IsDirectCheckBit = (u32)1 << 18;
+    static const u32 IsDiscoveredCheckBit = (u32)1 << 19;
+
+    u32 bits;
 
     MoveInfoT(const MoveTypeT moveType, const PieceTypeT pieceType, const SquareT from, const SquareT to, const bool isDirectCheck, const bool isDiscoveredCheck, const bool isPromo = false):
-      moveType(moveType), pieceType(pieceType), from(from), to(to), isDirectCheck(isDirectCheck), isDiscoveredCheck(isDiscoveredCheck), isPromo(isPromo) {}
+      bits(((u32)(from & 0x3f) << FromShift) | ((u32)(to & 0x3f) << ToShift) | ((u32)moveType << MoveTypeShift) | ((u32)pieceType << PieceTypeShift) |
+	   (isPromo ? IsPromoBit : 0) | (isDirectCheck ? IsDirectCheckBit : 0) | (isDiscoveredCheck ? IsDiscoveredCheckBit : 0)) {}
+
+    SquareT from() const { return (SquareT) ((bits >> FromShift) & 0x3f); }
+    SquareT to() const { return (SquareT) ((bits >> ToShift) & 0x3f); }
+    MoveTypeT moveType() const { return (MoveTypeT) ((bits >> MoveTypeShift) & 0x3); }
+    PieceTypeT pieceType() const { return (PieceTypeT) ((bits >> PieceTypeShift) & 0x7); }
+    bool isPromo() const { return (bits & IsPromoBit) != 0; }
+    bool isDirectCheck() const { return (bits & IsDirectCheckBit) != 0; }
+    bool isDiscoveredCheck() const { return (bits & IsDiscoveredCheckBit) != 0; }
+    // Either direct or discovered check
+    bool isCheck() const { return (bits & (IsDirectCheckBit | IsDiscoveredCheckBit)) != 0; }
   };
 
+  static_assert(sizeof(MoveInfoT) == sizeof(u32), "MoveInfoT should pack into one 32-bit word");
+
   enum SliderDirectionT {
     Diagonal,
     Orthogonal,
@@ -0,0 +1,168 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+// Work-stealing task pool for a fixed set of worker threads
+//
+// Each worker owns a deque of tasks - the owner pushes and pops at the back (depth-first, cache friendly),
+//   and idle workers steal from the front of other workers' deques (oldest, hence typically largest, tasks).
+// Deques are individually locked so there is no global lock; thieves check a racy size hint before locking
+//   so that probing (mostly empty) deques stays cheap.
+// Each steal round only probes a few random victims rather than scanning every deque, so that lots of idle
+//   workers don't all hammer every deque's cache line - an idle worker that keeps missing backs off to sleeping.
+// The pool is finished when every task that was pushed has been marked done - tasks may push more tasks.
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+
+namespace Chess {
+
+  namespace WorkStealingPool {
+
+    // Cache line aligned so that workers' deques don't false-share
+    template <typename TaskT>
+    struct alignas(64) WorkStealingDequeT {
+      std::mutex m;
+      std::deque<TaskT> tasks;
+      // Updated under the lock, read racily by thieves
+      std::atomic<size_t> size;
+
+      WorkStealingDequeT(): size(0) {}
+    };
+
+    template <typename TaskT>
+    class WorkStealingPool {
+      typedef WorkStealingDequeT<TaskT> DequeT;
+
+      const int n_threads;
+      std::vector<DequeT> deques; // indexed by thread number
+
+      // Tasks pushed but not yet done - including tasks currently running
+      std::atomic<u64> n_pending;
+      // Workers currently looking for work
+      std::atomic<int> n_idle;
+
+      // Number of fruitless steal rounds before an idle worker backs off to sleeping
+      static const int SpinRounds = 64;
+      // Number of random victims probed per steal round
+      static const int StealAttempts = 4;
+
+      // Non-copyable
+      WorkStealingPool(const WorkStealingPool&) = delete;
+      WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+      bool pop_back(const int thread_no, TaskT& task) {
+	DequeT& deque = deques[thread_no];
+	if(deque.size.load(std::memory_order_relaxed) == 0) {
+	  return false;
+	}
+	std::unique_lock<std::mutex> lock(deque.m);
+	if(deque.tasks.empty()) {
+	  return false;
+	}
+	task = deque.tasks.back();
+	deque.tasks.pop_back();
+	deque.size.store(deque.tasks.size(), std::memory_order_relaxed);
+	return true;
+      }
+
+      bool pop_front(const int thread_no, TaskT& task) {
+	DequeT& deque = deques[thread_no];
+	if(deque.size.load(std::memory_order_relaxed) == 0) {
+	  return false;
+	}
+	std::unique_lock<std::mutex> lock(deque.m);
+	if(deque.tasks.empty()) {
+	  return false;
+	}
+	task = deque.tasks.front();
+	deque.tasks.pop_front();
+	deque.size.store(deque.tasks.size(), std::memory_order_relaxed);
+	return true;
+      }
+
+      // Probe a few random other deques
+      bool steal(const int thread_no, u64& rand_state, TaskT& task) {
+	if(n_threads < 2) {
+	  return false;
+	}
+
+	for(int i = 0; i < StealAttempts; i++) {
+	  // xorshift64
+	  rand_state ^= rand_state << 13;
+	  rand_state ^= rand_state >> 7;
+	  rand_state ^= rand_state << 17;
+
+	  // Any thread but me
+	  int victim = (int)(rand_state % (u64)(n_threads - 1));
+	  if(victim >= thread_no) {
+	    victim++;
+	  }
+	  if(pop_front(victim, task)) {
+	    return true;
+	  }
+	}
+	return false;
+      }
+
+    public:
+      WorkStealingPool(const int n_threads):
+	n_threads(n_threads), deques(n_threads), n_pending(0), n_idle(0) {}
+
+      int size() const { return n_threads; }
+
+      // Push a task onto the back of the given worker's deque
+      void push(const int thread_no, const TaskT& task) {
+	n_pending.fetch_add(1, std::memory_order_relaxed);
+	DequeT& deque = deques[thread_no];
+	std::unique_lock<std::mutex> lock(deque.m);
+	deque.tasks.push_back(task);
+	deque.size.store(deque.tasks.size(), std::memory_order_relaxed);
+      }
+
+      // True iff some worker is currently looking for work - a cheap hint for busy workers to split their work
+      bool has_idle() const {
+	return n_idle.load(std::memory_order_relaxed) > 0;
+      }
+
+      // Get the next task for the given worker - own deque first, else steal.
+      // Returns false once all tasks are done.
+      bool get_task(const int thread_no, u64& rand_state, TaskT& task) {
+	if(pop_back(thread_no, task) || steal(thread_no, rand_state, task)) {
+	  return true;
+	}
+
+	n_idle.fetch_add(1, std::memory_order_relaxed);
+	for(int round = 0; ; round++) {
+	  if(n_pending.load(std::memory_order_acquire) == 0) {
+	    n_idle.fetch_sub(1, std::memory_order_relaxed);
+	    return false;
+	  }
+	  if(steal(thread_no, rand_state, task)) {
+	    n_idle.fetch_sub(1, std::memory_order_relaxed);
+	    return true;
+	  }
+	  if(round < SpinRounds) {
+	    std::this_thread::yield();
+	  } else {
+	    std::this_thread::sleep_for(std::chrono::microseconds(100));
+	  }
+	}
+      }
+
+      // Mark a task returned by get_task() as done - any tasks it pushed must be pushed before this.
+      void task_done() {
+	n_pending.fetch_sub(1, std::memory_order_release);
+      }
+    };
+
+  } // namespace WorkStealingPool
+
+} // namespace Chess
+
+#endif //ndef WORK_STEALING_POOL_HPP
@@ -0,0 +1,50 @@
+#include "zobrist.hpp"
+
+namespace Chess {
+  namespace Zobrist {
+    ZobristKeyT PieceKeys[NColors][NPieceTypes][64+1];
+    ZobristKeyT CastlingRightsKeys[NColors][4];
+    ZobristKeyT EpSquareKeys[64+1];
+    ZobristKeyT BlackToMoveKey;
+
+    // splitmix64 with a fixed seed - keys MUST be the same from run to run.
+    static u64 zobristSeed = 0x736b61616b2d7a62ULL;
+
+    static ZobristKeyT nextKey() {
+      u64 z = (zobristSeed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+    }
+
+    static void initZobristKeys() {
+      for(size_t color = 0; color < NColors; color++) {
+	for(int pieceType = Pawn; pieceType < NPieceTypes; pieceType++) {
+	  for(SquareT square = A1; square <= H8; square++) {
+	    PieceKeys[color][pieceType][square] = nextKey();
+	  }
+	}
+      }
+
+      for(size_t color = 0; color < NColors; color++) {
+	CastlingRightsKeys[color][CanCastleQueenside] = nextKey();
+	CastlingRightsKeys[color][CanCastleKingside] = nextKey();
+	CastlingRightsKeys[color][CanCastleQueenside | CanCastleKingside] = CastlingRightsKeys[color][CanCastleQueenside] ^ CastlingRightsKeys[color][CanCastleKingside];
+      }
+
+      for(SquareT square = A1; square <= H8; square++) {
+	EpSquareKeys[square] = nextKey();
+      }
+
+      BlackToMoveKey = nextKey();
+    }
+
+    struct ZobristInit {
+      ZobristInit() {
+	initZobristKeys();
+      }
+    } zobristInit;
+
+  } // namespace Zobrist
+
+} // namespace Chess
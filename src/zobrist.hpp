@@ -0,0 +1,37 @@
+#ifndef ZOBRIST_HPP
+#define ZOBRIST_HPP
+
+#include "types.hpp"
+
+namespace Chess {
+
+  namespace Zobrist {
+
+    typedef u64 ZobristKeyT;
+
+    // Bump this if the key generation changes - persisted hashes are only valid for the same scheme.
+    const u64 ZobristSchemeVersion = 1;
+
+    // Keys are by piece type rather than by PieceT or promo index, so that equivalent positions hash the same
+    //   irrespective of which knight is Knight1, or whether the board is a BasicBoardT or FullBoardT.
+    // The NoPieceType and InvalidSquare entries are zero so that they can be xor'ed in blindly.
+    extern ZobristKeyT PieceKeys[NColors][NPieceTypes][64+1];
+
+    // Indexed by CastlingRightsT bitmap - key[CanCastleQueenside|CanCastleKingside] = key[CanCastleQueenside] ^ key[CanCastleKingside]
+    extern ZobristKeyT CastlingRightsKeys[NColors][4];
+
+    // Only included in the board key if the ep square is actually capturable by an opponent pawn.
+    extern ZobristKeyT EpSquareKeys[64+1];
+
+    // The board key doesn't include the side to move - xor this in for black to move where it matters.
+    extern ZobristKeyT BlackToMoveKey;
+
+    inline ZobristKeyT colorToMoveKey(const ColorT colorToMove) {
+      return colorToMove == White ? 0 : BlackToMoveKey;
+    }
+
+  } // namespace Zobrist
+
+} // namespace Chess
+
+#endif //ndef ZOBRIST_HPP